@@ -0,0 +1,335 @@
+/**
+ * @file        xformatbench.c
+ *
+ * @brief       Benchmark of each conversion of xformatc against vsnprintf
+ *
+ * Each case is one format with one family of conversion, timed with a
+ * monotonic clock for a number of repetitions of the same loop. The
+ * mean, the minimum and the standard deviation of the ns for one call
+ * and the throughput are printed as a table or as JSON to track the
+ * performance across versions :
+ *
+ *   xformatbench [-json] [iterations] [repeat]
+ *
+ *
+ * @author      Mario Viara
+ *
+ * @version     1.00
+ *
+ * @copyright   Copyright Mario Viara 2014  - License Open Source (LGPL)
+ * This is a free software and is opened for education, research and commercial
+ * developments under license policy of following terms:
+ * - This is a free software and there is NO WARRANTY.
+ * - No restriction on use. You can use, modify and redistribute it for personal,
+ *   non-profit or commercial product UNDER YOUR RESPONSIBILITY.
+ * - Redistributions of source code must retain the above copyright notice.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+#include "xformatc.h"
+
+#define BENCH_SIZE		256
+#define BENCH_REPEAT	9
+#define BENCH_MAX		32
+
+
+typedef int (*format_t)(char * buf,size_t size,const char * fmt,...);
+
+/**
+ * One benchmark case, run calls the format function once for the
+ * iteration i and return the number of chars.
+ */
+struct bench_s
+{
+	const char *	name;
+	const char *	fmt;
+	int				(*run)(format_t format,char * buf,long i);
+};
+
+/**
+ * Statistics of one case for one library
+ */
+struct result_s
+{
+	double	mean;
+	double	min;
+	double	stddev;
+	double	mbps;
+};
+
+
+static const char payload[] = "the quick brown fox jump over the lazy dog";
+static const char * const words[4] = {"alpha","beta","gamma","delta"};
+static volatile long sink;
+
+
+static int xformatFormat(char * buf,size_t size,const char * fmt,...)
+{
+	va_list list;
+	int count;
+
+	va_start(list,fmt);
+	count = (int)xvsnformat(buf,size,fmt,list);
+	va_end(list);
+
+	return count;
+}
+
+
+static int systemFormat(char * buf,size_t size,const char * fmt,...)
+{
+	va_list list;
+	int count;
+
+	va_start(list,fmt);
+	count = vsnprintf(buf,size,fmt,list);
+	va_end(list);
+
+	return count;
+}
+
+
+/*
+ * Cases, the arguments change with the iteration
+ */
+static int benchLiteral(format_t format,char * buf,long i)
+{
+	(void)i;
+	return (*format)(buf,BENCH_SIZE,"Literal text only without any conversion, typical log prefix");
+}
+
+static int benchInt(format_t format,char * buf,long i)
+{
+	return (*format)(buf,BENCH_SIZE,"%d %d %d",(int)i - 500000,(int)(i & 0xff),-(int)(i * 7919));
+}
+
+static int benchLong(format_t format,char * buf,long i)
+{
+	return (*format)(buf,BENCH_SIZE,"%ld %lu",i * -104729L,(unsigned long)i * 15485863UL);
+}
+
+#if XCFG_FORMAT_LONGLONG
+static int benchLongLong(format_t format,char * buf,long i)
+{
+	return (*format)(buf,BENCH_SIZE,"%lld %llu",(long long)i * -1000000007LL,(unsigned long long)i * 6364136223846793005ULL);
+}
+#endif
+
+static int benchHex(format_t format,char * buf,long i)
+{
+	return (*format)(buf,BENCH_SIZE,"%x %08X %#lx",(unsigned)i * 2654435761u,(unsigned)i,(unsigned long)i * 40503UL);
+}
+
+static int benchPointer(format_t format,char * buf,long i)
+{
+	return (*format)(buf,BENCH_SIZE,"%p %p",(void *)(payload + (i & 15)),(void *)&sink);
+}
+
+static int benchString(format_t format,char * buf,long i)
+{
+	return (*format)(buf,BENCH_SIZE,"%s %s %s",words[i & 3],payload,words[(i >> 2) & 3]);
+}
+
+static int benchPrecision(format_t format,char * buf,long i)
+{
+	return (*format)(buf,BENCH_SIZE,"%.16s|%.*s|",payload + (i & 7),(int)(i & 15),payload);
+}
+
+static int benchPadding(format_t format,char * buf,long i)
+{
+	return (*format)(buf,BENCH_SIZE,"|%10d|%-10u|%08x|%20s|%-20s|",(int)(i & 0xffff),(unsigned)i,(unsigned)i,words[i & 3],words[(i >> 2) & 3]);
+}
+
+static int benchChar(format_t format,char * buf,long i)
+{
+	return (*format)(buf,BENCH_SIZE,"%c%c%c %%",(int)('a' + (i & 15)),'-',(int)('A' + (i & 7)));
+}
+
+#if XCFG_FORMAT_FLOAT
+static int benchFloat(format_t format,char * buf,long i)
+{
+	return (*format)(buf,BENCH_SIZE,"%f %.2f",(double)i / 7.0,(double)(i & 0xffff) * 0.01);
+}
+
+static int benchExp(format_t format,char * buf,long i)
+{
+	return (*format)(buf,BENCH_SIZE,"%e %g",(double)i * 1.5e-7,(double)i / 3.0);
+}
+#endif
+
+static int benchMixed(format_t format,char * buf,long i)
+{
+	return (*format)(buf,BENCH_SIZE,"[%05ld] %-8s %s code=%d addr=%#x",i,words[i & 3],payload,(int)(i % 600),(unsigned)i * 4096u);
+}
+
+
+static const struct bench_s cases[] =
+{
+	{"literal",		"Literal text only ...",	benchLiteral},
+	{"int",			"%d %d %d",					benchInt},
+	{"long",		"%ld %lu",					benchLong},
+#if XCFG_FORMAT_LONGLONG
+	{"longlong",	"%lld %llu",				benchLongLong},
+#endif
+	{"hex",			"%x %08X %#lx",				benchHex},
+	{"pointer",		"%p %p",					benchPointer},
+	{"string",		"%s %s %s",					benchString},
+	{"precision",	"%.16s|%.*s|",				benchPrecision},
+	{"padding",		"|%10d|%-10u|%08x|%20s|%-20s|",	benchPadding},
+	{"char",		"%c%c%c %%",				benchChar},
+#if XCFG_FORMAT_FLOAT
+	{"float",		"%f %.2f",					benchFloat},
+	{"exp",			"%e %g",					benchExp},
+#endif
+	{"mixed",		"[%05ld] %-8s %s code=%d addr=%#x",	benchMixed},
+};
+
+#define NUM_CASES	(sizeof(cases) / sizeof(cases[0]))
+
+
+/**
+ * Monotonic time in ns
+ */
+static double benchNow(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+
+	return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+
+/**
+ * Run one case for one library and compute the statistics
+ */
+static void benchRun(const struct bench_s * b,format_t format,long iterations,int repeat,struct result_s * r)
+{
+	double ns[BENCH_MAX];
+	char buf[BENCH_SIZE];
+	double start,sum = 0,var = 0;
+	long i,chars = 0;
+	int j;
+
+	/* Warm up caches and branch predictors */
+	for (i = 0 ; i < iterations / 10 + 1 ; i++)
+	{
+		chars += (*b->run)(format,buf,i);
+	}
+
+	chars = 0;
+
+	for (j = 0 ; j < repeat ; j++)
+	{
+		start = benchNow();
+		for (i = 0 ; i < iterations ; i++)
+		{
+			chars += (*b->run)(format,buf,i);
+		}
+		ns[j] = (benchNow() - start) / (double)iterations;
+	}
+
+	sink += chars;
+
+	r->min = 0;
+	for (j = 0 ; j < repeat ; j++)
+	{
+		sum += ns[j];
+		if (j == 0 || ns[j] < r->min)
+			r->min = ns[j];
+	}
+
+	r->mean = sum / repeat;
+
+	for (j = 0 ; j < repeat ; j++)
+	{
+		var += (ns[j] - r->mean) * (ns[j] - r->mean);
+	}
+
+	r->stddev = sqrt(var / repeat);
+
+	/* Output bytes for each ns is equal to GB/s, reported as MB/s */
+	r->mbps = (double)chars / ((double)repeat * (double)iterations) / r->mean * 1000.0;
+}
+
+
+static void printJson(const struct result_s * r)
+{
+	printf("{\"ns_op\": %.2f, \"ns_min\": %.2f, \"ns_stddev\": %.2f, \"mops\": %.2f, \"mb_s\": %.1f}",
+		r->mean,r->min,r->stddev,1000.0 / r->mean,r->mbps);
+}
+
+
+int main(int argc,char **argv)
+{
+	struct result_s x[NUM_CASES],s[NUM_CASES];
+	long iterations = 200000;
+	int repeat = BENCH_REPEAT;
+	int json = 0;
+	int arg = 1;
+	unsigned i;
+
+	if (argc > arg && strcmp(argv[arg],"-json") == 0)
+	{
+		json = 1;
+		arg++;
+	}
+
+	if (argc > arg)
+		iterations = atol(argv[arg++]);
+	if (argc > arg)
+		repeat = atoi(argv[arg++]);
+
+	if (iterations < 1 || repeat < 1 || repeat > BENCH_MAX)
+	{
+		printf("usage: xformatbench [-json] [iterations] [repeat <= %d]\n",BENCH_MAX);
+		exit(1);
+	}
+
+	if (!json)
+	{
+		printf("Benchmark xformatc against vsnprintf, %ld iterations x %d\n\n",iterations,repeat);
+		printf("%-10s %-32s %10s %8s %8s %10s %10s %8s\n","case","format","xformatc","min","stddev","MB/s","vsnprintf","speedup");
+	}
+
+	for (i = 0 ; i < NUM_CASES ; i++)
+	{
+		benchRun(&cases[i],xformatFormat,iterations,repeat,&x[i]);
+		benchRun(&cases[i],systemFormat,iterations,repeat,&s[i]);
+
+		if (!json)
+		{
+			printf("%-10s %-32s %7.1f ns %8.1f %8.2f %10.1f %7.1f ns %7.2fx\n",cases[i].name,cases[i].fmt,
+				x[i].mean,x[i].min,x[i].stddev,x[i].mbps,s[i].mean,s[i].mean / x[i].mean);
+			fflush(stdout);
+		}
+	}
+
+	if (json)
+	{
+		printf("{\n  \"iterations\": %ld,\n  \"repeat\": %d,\n  \"config\": {\"float\": %d, \"longlong\": %d, \"scan\": %d, \"simd\": %d},\n  \"cases\": [\n",
+			iterations,repeat,XCFG_FORMAT_FLOAT,XCFG_FORMAT_LONGLONG,XCFG_FORMAT_SCAN,XCFG_FORMAT_SIMD);
+
+		for (i = 0 ; i < NUM_CASES ; i++)
+		{
+			printf("    {\"name\": \"%s\", \"format\": \"%s\", \"xformatc\": ",cases[i].name,cases[i].fmt);
+			printJson(&x[i]);
+			printf(", \"vsnprintf\": ");
+			printJson(&s[i]);
+			printf(", \"speedup\": %.3f}%s\n",s[i].mean / x[i].mean,i + 1 < NUM_CASES ? "," : "");
+		}
+
+		printf("  ]\n}\n");
+	}
+
+	return 0;
+}
@@ -38,6 +38,48 @@
 
 #include  "xformatc.h"
 
+#if XCFG_FORMAT_FLOAT && XCFG_FORMAT_FLOAT_EXACT
+#include <limits.h>
+#endif
+
+/*
+ * The word and SSE2 scans read the whole aligned block holding the nul,
+ * after the end of the string. The read is deliberate and safe, but
+ * AddressSanitizer reports it : the scan functions are not instrumented
+ * or, without the attribute, the text is scanned one char at time.
+ */
+#if defined(__SANITIZE_ADDRESS__)
+#define SCAN_ASAN	1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define SCAN_ASAN	1
+#endif
+#endif
+
+#ifndef SCAN_ASAN
+#define SCAN_NOASAN
+#elif defined(__GNUC__)
+#define SCAN_NOASAN	__attribute__((__no_sanitize_address__))
+#else
+#define SCAN_NOASAN
+#undef XCFG_FORMAT_SCAN
+#define XCFG_FORMAT_SCAN	0
+#endif
+
+#if XCFG_FORMAT_SCAN == 2 && (defined(__SSE2__) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#elif XCFG_FORMAT_SCAN == 2
+#undef XCFG_FORMAT_SCAN
+#define XCFG_FORMAT_SCAN	1
+#endif
+
+#if XCFG_FORMAT_SIMD == 2 && (defined(__SSSE3__) || defined(__AVX__))
+#include <tmmintrin.h>
+#elif XCFG_FORMAT_SIMD == 2
+#undef XCFG_FORMAT_SIMD
+#define XCFG_FORMAT_SIMD	1
+#endif
+
 
 
 /**
@@ -81,6 +123,15 @@
 #define FLOAT_TYPE		FLAG_TYPE_LONG
 #endif
 
+/**
+ * Largest unsigned integer supported
+ */
+#if XCFG_FORMAT_LONGLONG
+#define ULARGE			unsigned LONGLONG
+#else
+#define ULARGE			unsigned LONG
+#endif
+
 /**
  * Determine the precision of floating point number
  */
@@ -94,6 +145,103 @@
 #define DOUBLE_ARGS		DOUBLE
 #endif
 
+#if XCFG_FORMAT_FLOAT && XCFG_FORMAT_FLOAT_EXACT
+/**
+ * Limb of the big numbers used for the exact floating point conversion
+ */
+#if UINT_MAX >= 0xFFFFFFFFUL
+typedef unsigned int	xlimb_t;
+#else
+typedef unsigned long	xlimb_t;
+#endif
+
+#define LIMB_BASE10		1000000000UL
+
+/**
+ * Number of limbs for the largest integer part (base 1e9) or
+ * fraction (base 2^32) of one floating point number.
+ */
+#if XCFG_FORMAT_FLOAT_PREC
+#define FLOAT_LIMBS		6
+#else
+#define FLOAT_LIMBS		36
+#endif
+
+/**
+ * Class of floating point number
+ */
+#define FLOAT_FINITE	0
+#define FLOAT_INF		1
+#define FLOAT_NAN		2
+
+/**
+ * Hidden bit of the mantissa and exponent of the smallest normal number
+ */
+#if XCFG_FORMAT_FLOAT_PREC
+#define FLOAT_HIDDEN	0x800000UL
+#define FLOAT_EMIN		(-149)
+#else
+#define FLOAT_HIDDEN	0x10000000000000ULL
+#define FLOAT_EMIN		(-1074)
+#endif
+
+/**
+ * Window of digits used to search the shortest representation, the
+ * first search use only one block of digits.
+ */
+#define SHORT_DIGITS	20
+#define SHORT_FAST		9
+
+/**
+ * Keep the exact expansion out of the frame of format()
+ */
+#if defined(__GNUC__)
+#define FLOAT_NOINLINE	__attribute__((__noinline__))
+#else
+#define FLOAT_NOINLINE
+#endif
+
+/**
+ * Exact decimal expansion of one floating point number
+ */
+struct fdigits_s
+{
+	/** Integer part in base 1e9 or fraction in base 2^32, lsb first */
+	xlimb_t				big[FLOAT_LIMBS];
+
+	/** Integer part if it fit in one long long */
+	unsigned LONGLONG	ipart;
+
+	/** Digits converted and not yet returned */
+	char				block[20];
+	int					bpos;
+	int					blen;
+
+	/** End of the not zero digits in the block */
+	int					bnz;
+
+	/** Limbs used, first not zero limb of the fraction */
+	int					nbig;
+	int					lo;
+
+	/** Integer part in big, next limb to convert and first not zero limb */
+	int					ibig;
+	int					next;
+	int					izero;
+
+	/** Number of digits of the integer part and digits not yet converted */
+	int					nint;
+	int					ileft;
+
+	/** Result of the rounding */
+	int					ndig;
+	int					last9;
+	int					lastnz;
+	char				roundup;
+	char				carry;
+};
+#endif
+
 /**
  * Structure with all parameter used
  */
@@ -119,6 +267,19 @@ struct param_s
 	 */
 	char*		out;
 
+	/**
+	 * Function to emit a run of chars and its argument, when
+	 * the function is null the output is written in memory.
+	 */
+	void		(*write)(void *arg,const char *p,size_t n);
+	void		*arg;
+
+	/**
+	 * Current position and end of the memory destination
+	 */
+	char*		buf;
+	char*		end;
+
 #if XCFG_FORMAT_FLOAT
 	/**
 	 * Floating point argument
@@ -130,6 +291,14 @@ struct param_s
 	 */
 	unsigned FLOAT_LONG	iPart;
 
+#if XCFG_FORMAT_FLOAT_EXACT
+	/**
+	 * Binary exponent of the floating point number, the exact expansion
+	 * is in the frame of outFloat.
+	 */
+	int			fexp;
+#endif
+
 #endif
 
 	
@@ -160,22 +329,25 @@ struct param_s
 	 */
 	unsigned flags;
 
-#define FLAG_TYPE_INT		0x0000	/* Argument is integer					*/
-#define FLAG_TYPE_LONG		0x0001	/* Argument is long						*/
-#define FLAG_TYPE_SIZEOF	0x0002	/* Argument is size_t					*/
-#define FLAG_TYPE_LONGLONG	0x0003	/* Argument is long long				*/
-#define	FLAG_TYPE_MASK		0x0003	/* Mask for field type					*/
-#define FLAG_PREC			0x0004	/* Precision set						*/
-#define FLAG_LEFT			0x0008	/* Left alignment						*/
-#define	FLAG_BLANK			0x0010	/* Blank before positive integer number */
-#define	FLAG_PREFIX			0x0020	/* Prefix required						*/
-#define FLAG_PLUS			0x0040	/* Force a + before positive number		*/
-#define	FLAG_UPPER			0x0080	/* Output in upper case letter			*/
-#define FLAG_DECIMAL		0x0100	/* Decimal field						*/
-#define FLAG_INTEGER		0x0200	/* Integer field						*/
+#define FLAG_TYPE_INT		XFORMAT_FLAG_TYPE_INT
+#define FLAG_TYPE_LONG		XFORMAT_FLAG_TYPE_LONG
+#define FLAG_TYPE_SIZEOF	XFORMAT_FLAG_TYPE_SIZEOF
+#define FLAG_TYPE_LONGLONG	XFORMAT_FLAG_TYPE_LONGLONG
+#define	FLAG_TYPE_MASK		XFORMAT_FLAG_TYPE_MASK
+#define FLAG_PREC			XFORMAT_FLAG_PREC
+#define FLAG_LEFT			XFORMAT_FLAG_LEFT
+#define	FLAG_BLANK			XFORMAT_FLAG_BLANK
+#define	FLAG_PREFIX			XFORMAT_FLAG_PREFIX
+#define FLAG_PLUS			XFORMAT_FLAG_PLUS
+#define	FLAG_UPPER			XFORMAT_FLAG_UPPER
+#define FLAG_DECIMAL		XFORMAT_FLAG_DECIMAL
+#define FLAG_INTEGER		XFORMAT_FLAG_INTEGER
 #define FLAG_MINUS			0x0400	/* Field is negative					*/
 #define FLAG_VALUE			0x0800	/* Value set							*/
 #define FLAG_BUFFER			0x1000	/* Buffer set							*/
+#define FLAG_POINTER		XFORMAT_FLAG_POINTER
+#define FLAG_FLOAT			0x4000	/* Floating point field					*/
+#define FLAG_REF			0x8000	/* Output can be referenced in place	*/
 
 	/**
 	 * Length of the prefix
@@ -199,14 +371,49 @@ struct param_s
 	/* char used for padding */
 	char		pad;
 
+#if XCFG_FORMAT_DEFER
+	/**
+	 * Deferred record and position of the next argument, when rec is
+	 * not null the arguments are read from the record.
+	 */
+	const char *	rec;
+	unsigned		recpos;
+#endif
+
+#if XCFG_FORMAT_BATCH
+	/**
+	 * Arrays of arguments, current row and column of the next argument,
+	 * when cols is not null the arguments are read from the arrays.
+	 */
+	const void * const *	cols;
+	size_t			row;
+	unsigned		col;
+#endif
+
+#if XCFG_FORMAT_ARGS
+	/**
+	 * Tagged arguments, their number and the position of the next one,
+	 * when targ is not null the arguments are read from the array.
+	 */
+	const struct xformat_arg_s *	targ;
+	unsigned		tcount;
+	unsigned		tpos;
+#endif
 
+#if XCFG_FORMAT_STATS
 	/**
-	 * Current state
+	 * Counters of the caller
 	 */
-	char		state;
+	struct xformat_stats_s *	stats;
+#endif
 
 };
 
+/**
+ * Width or precision of a specifier taken from the arguments
+ */
+#define SPEC_ARG	XFORMAT_SPEC_ARG
+
 
 /**
  * Enum for the internal state machine
@@ -279,8 +486,16 @@ static const char  ms_true[] = "True";
  */
 static const char  ms_false[]= "False";
 
+#if XCFG_FORMAT_FLOAT && XCFG_FORMAT_FLOAT_EXACT
+/**
+ * String for infinite and not a number
+ */
+static const char  ms_inf[] = "inf";
+static const char  ms_nan[] = "nan";
+#endif
 
-#if XCFG_FORMAT_FLOAT
+
+#if XCFG_FORMAT_FLOAT && !XCFG_FORMAT_FLOAT_EXACT
 static  DOUBLE xpow10(int e)
 {
 	DOUBLE result = 1.0;
@@ -327,691 +542,4283 @@ static const char *checkFloat(DOUBLE value)
    
 /*
  * This table contains the next state for all char and it will be
- * generate using xformattable.c
+ * generate using xformattable.c in XFORMAT_STATES of xformatc.h,
+ * shared with the compile time parser of xformatc.hpp.
  */
 
 static const unsigned char formatStates[] =
 {
-	0x06,0x00,0x00,0x06,0x00,0x01,0x00,0x00,
-	0x10,0x00,0x03,0x06,0x00,0x06,0x02,0x10,
-	0x04,0x45,0x45,0x45,0x45,0x05,0x05,0x05,
-	0x05,0x35,0x30,0x00,0x50,0x60,0x00,0x00,
-	0x00,0x20,0x28,0x38,0x50,0x50,0x00,0x00,
-	0x00,0x30,0x30,0x30,0x50,0x50,0x00,0x00,
-	0x08,0x20,0x20,0x28,0x20,0x20,0x20,0x00,
-	0x08,0x60,0x60,0x60,0x60,0x60,0x60,0x00,
-	0x00,0x70,0x78,0x78,0x78,0x70,0x78,0x00,
-	0x07,0x08,0x00,0x00,0x07,0x00,0x00,0x08,
-	0x08,0x00,0x00,0x08,0x00,0x08,0x00,0x00,
-	0x08,0x00,0x07
+	XFORMAT_STATES
 };
 
 
 static const char ms_digits[] = "0123456789abcdef";
+static const char ms_udigits[] = "0123456789ABCDEF";
 
-#define U2A(name,type,value) \
-static void name(struct param_s * param) \
-{ \
-	unsigned char digit; \
-	type val = param->values.value ; \
-	while (param->prec -- > 0 ||  val) \
-	{ \
-		switch (param->radix) \
-		{ \
-			case 2: \
-				digit = val & 0x01; \
-				val >>= 1; \
-				break; \
-			case 8: \
-				digit = val & 0x07; \
-				val >>= 3; \
-				break; \
-			case 16: \
-				digit = val & 0x0F;\
-				val  >>= 4; \
-				break; \
-			default: \
-			case 10:  \
-				digit = (unsigned char)(val % 10); \
-				val  /= 10; \
-				break; \
-		} \
-		*param->out -- = ms_digits[digit]; \
-		param->length ++ ;\
-	} \
-}
-
+/**
+ * Blocks used to emit the padding with one call to the output function
+ */
+static const char ms_spaces[] = "                ";
+static const char ms_zeros[]  = "0000000000000000";
 
+/**
+ * Pairs of decimal digits from "00" to "99"
+ */
+static const char ms_pairs[] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
 
 
 /**
- * Convert an unsigned long value in one string
- *
- * All parameter are in the passed structure
- *
- * @param prec		- Minimum precision
- * @param lvalue	- Unsigned value
- * @param radix		- Radix (Supported values 2/8/10/16)
+ * Number of decimal digits of one value.
  *
- * @param out		- Buffer with the converted value.
+ * @param val - Value
+ * @return The number of digits, 0 for the value 0.
  */
-U2A(ulong2a,unsigned LONG,lvalue)
-#if XCFG_FORMAT_LONGLONG
-#ifdef XCFG_FORMAT_LONG_ARE_LONGLONG
-#define	ullong2a	ulong2a
+#if defined(__GNUC__) && XCFG_FORMAT_LONGLONG
+static const unsigned LONGLONG ms_pow10[] =
+{
+	1ULL,10ULL,100ULL,1000ULL,10000ULL,100000ULL,1000000ULL,10000000ULL,
+	100000000ULL,1000000000ULL,10000000000ULL,100000000000ULL,1000000000000ULL,
+	10000000000000ULL,100000000000000ULL,1000000000000000ULL,10000000000000000ULL,
+	100000000000000000ULL,1000000000000000000ULL,10000000000000000000ULL
+};
+
+static int decDigits(ULARGE val)
+{
+	/* 1233 / 4096 is log10(2), the estimate is corrected by the table */
+	int n = ((int)(sizeof(unsigned long long) * 8) - __builtin_clzll((unsigned long long)val | 1)) * 1233 >> 12;
+
+	return n + (val >= ms_pow10[n]);
+}
 #else
-U2A(ullong2a,unsigned LONGLONG,llvalue)
-#endif
+static int decDigits(ULARGE val)
+{
+	ULARGE p = 1;
+	int n = 0;
+
+	while (val >= p)
+	{
+		n++;
+		if (p > (ULARGE)-1 / 10)
+			break;
+		p *= 10;
+	}
+
+	return n;
+}
 #endif
 
+
 /**
- * Printf like using variable arguments.
- * 
- * @param outchar - Pointer to the function to output one new char.
- * @param arg	- Argument for the output function.
- * @param fmt	- Format options for the list of parameters.
- * @param ...	- Arguments
+ * Convert one value in decimal two digits at time, the digits are
+ * written ending at out without leading zero.
  *
- * @return The number of char emitted.
- * 
- * @see xvformat
+ * @param out	- Position of the last digit.
+ * @param val	- Value
+ *
+ * @return The position before the first digit.
  */
-unsigned xformat(void (*outchar)(void *,char),void *arg,const char * fmt,...)
+static char * pairs2a(char * out,unsigned LONG val)
 {
-	va_list list;
-	unsigned count;
+	unsigned d;
 
-	va_start(list,fmt);
-	count = xvformat(outchar,arg,fmt,list);
-	va_end(list);
+	while (val >= 100)
+	{
+		d = (unsigned)(val % 100) * 2;
+		val /= 100;
+		out[0] = ms_pairs[d + 1];
+		out[-1] = ms_pairs[d];
+		out -= 2;
+	}
 
-	(void)list;
+	if (val >= 10)
+	{
+		d = (unsigned)val * 2;
+		out[0] = ms_pairs[d + 1];
+		out[-1] = ms_pairs[d];
+		out -= 2;
+	}
+	else if (val)
+	{
+		*out-- = (char)('0' + val);
+	}
 
-	return count;
+	return out;
 }
 
 
 /**
- * We do not want use any library function.
+ * Convert an unsigned value in decimal.
  *
- * @param s - C	 string
- * @return The length of the string
+ * The number of digits is known before the conversion so the
+ * field is sized once and filled with zero up to the precision.
+ *
+ * @param prec		- Minimum precision
+ * @param lvalue	- Unsigned value
+ *
+ * @param out		- Buffer with the converted value.
  */
-static unsigned xstrlen(const char *s)
+static void ulong2dec(struct param_s * param)
 {
-	const char *i;
+	char * out = param->out;
+	int n = decDigits(param->values.lvalue);
+
+	if (n < param->prec)
+		n = param->prec;
+
+	param->length += n;
+	param->out -= n;
+
+	out = pairs2a(out,param->values.lvalue);
 
-	for (i = s ; *i ; i++)
+	while (out > param->out)
 	{
+		*out-- = '0';
 	}
-
-	return (unsigned)(i - s);
 }
 
-static unsigned outBuffer(void (*myoutchar)(void *arg,char),void *arg,const char *buffer,int len,unsigned  toupper)
+#if XCFG_FORMAT_LONGLONG
+#ifdef XCFG_FORMAT_LONG_ARE_LONGLONG
+#define ullong2pairs	pairs2a
+#else
+/**
+ * Convert one long long value in decimal, when long is smaller than
+ * long long the value is split in chunk of 8 digits to use only one
+ * long long division for each.
+ *
+ * @see pairs2a
+ */
+static char * ullong2pairs(char * out,unsigned LONGLONG val)
 {
-	unsigned count = 0;
-	int i;
-	char c;
+	char * chunk;
 
-	for (i = 0; i < len ; i++)
+	while (sizeof(unsigned LONGLONG) > sizeof(unsigned LONG) && val > (unsigned LONG)-1)
 	{
-		c = buffer[i];
-
-		if (toupper && (c >= 'a' && c <= 'z'))
+		chunk = out - 8;
+		out = pairs2a(out,(unsigned LONG)(val % 100000000));
+		val /= 100000000;
+		while (out > chunk)
 		{
-			c = (char)(c - ('a' - 'A'));
+			*out-- = '0';
 		}
-
-		(*myoutchar)(arg,c);
-		count++;
 	}
 
+	return pairs2a(out,(unsigned LONG)val);
+}
+
 
-	return count;
+static void ullong2dec(struct param_s * param)
+{
+	unsigned LONGLONG val = param->values.llvalue;
+	char * out = param->out;
+	int n = decDigits(val);
+
+	if (n < param->prec)
+		n = param->prec;
+
+	param->length += n;
+	param->out -= n;
+
+	out = ullong2pairs(out,val);
+
+	while (out > param->out)
+	{
+		*out-- = '0';
+	}
 }
+#endif
+#endif
 
 
-static unsigned outChars(void (*myoutchar)(void *arg,char),void *arg,char ch,int len)
+/**
+ * Number of significant bits of one value.
+ *
+ * @param val - Value
+ * @return The number of bits, 0 for the value 0.
+ */
+static int bitLength(ULARGE val)
 {
-	unsigned count= 0;
+#if defined(__GNUC__) && XCFG_FORMAT_LONGLONG
+	return val ? (int)(sizeof(unsigned long long) * 8) - __builtin_clzll((unsigned long long)val) : 0;
+#elif defined(__GNUC__)
+	return val ? (int)(sizeof(unsigned long) * 8) - __builtin_clzl((unsigned long)val) : 0;
+#else
+	int n = 0;
 
-	while (len-- > 0)
+	while (val >= 0x100)
 	{
-		(*myoutchar)(arg,ch);
-		count++;
+		val >>= 8;
+		n += 8;
 	}
 
-	return count;
+	while (val)
+	{
+		val >>= 1;
+		n++;
+	}
+
+	return n;
+#endif
 }
 
 
+#if XCFG_FORMAT_SIMD
+#define SIMD_ONES	0x0101010101010101ULL
 
-/*
- * Lint want declare list as const but list is an obscured pointer so
- * the warning is disabled.
+/**
+ * Store the 8 bytes of one word in reverse order ending at out, the
+ * lowest byte is the last digit.
  */
-/*lint -save -e818 */
+static void simdStore(char * out,unsigned LONGLONG w)
+{
+	int i;
+
+	for (i = 0 ; i < 8 ; i++)
+	{
+		out[-i] = (char)(w >> (i * 8));
+	}
+}
 
 
+#if XCFG_FORMAT_SIMD == 1
 /**
- * Printf like format function.
- *
- * General format :
- * 
- * %[width][.precision][flags]type
- *
- * - width Is the minimum size of the field.
- * 
- * - precision Is the maximum size of the field.
- * 
- * Supported flags :
- * 
- * - l	With integer number the argument will be of type long.
- * - ll With integer number the argument will be of type long long.
- * -	Space for positive integer a space will be added before.
- * - z	Compatible with C99 the argument is size_t (aka sizeof(void *))
- * - +	A + sign prefix positive number.
- * - #	A prefix will be printed (o for octal,0x for hex,0b for binary)
- * - 0	Value will be padded with zero (default is spacwe)
- * - -	Left justify as default filed have rigth justification.
- * 
- * Supported type :
- * 
- * - s	Null terminated string of char.
- * - S	Null terminated string of char in upper case.
- * - i	Integer number.
- * - d	Integer number.
- * - u	Unsigned number.
- * - x	Unsigned number in hex.
- * - X	Unsigned number in hex upper case.
- * - b	Binary number
- * - o	Octal number
- * - p	Pointer will be emitted with the prefix ->
- * - P	Pointer in upper case letter.
- * - f	Floating point number.
- * - B	Boolean value printed as True / False.
- *
- * @param outchar - Pointer to the function to output one char.
- * @param arg	- Argument for the output function.
- * @param fmt	- Format options for the list of parameters.
- * @param args	- List parameters.
+ * Convert the low 32 bits of one value in 8 hex digits ending at out.
  *
- * @return The number of char emitted.
+ * The nibbles are spread one for each byte then converted to ASCII
+ * adding '0' and the distance to the letters for the digits over 9.
  */
-unsigned xvformat(void (*outchar)(void *,char),void *arg,const char * fmt,va_list _args)
+static void simdHex8(char * out,unsigned LONGLONG val,int upper)
 {
-	XCFG_FORMAT_STATIC struct param_s param;
-	int i;
-	char c;
-	
-#if XCFG_FORMAT_VA_COPY
-	va_list args;
+	unsigned LONGLONG t = val & 0xFFFFFFFFULL;
 
-	va_copy(args,_args);
-#else
-#define args	_args
-#endif
+	t = (t | (t << 16)) & 0x0000FFFF0000FFFFULL;
+	t = (t | (t <<  8)) & 0x00FF00FF00FF00FFULL;
+	t = (t | (t <<  4)) & 0x0F0F0F0F0F0F0F0FULL;
 
-	param.count = 0;
-	param.state = ST_NORMAL;
+	t += SIMD_ONES * '0' + (((t + SIMD_ONES * 6) >> 4) & SIMD_ONES) * (upper ? 'A' - '0' - 10 : 'a' - '0' - 10);
 
-	while (*fmt)
-	{
-		c = *fmt++;
+	simdStore(out,t);
+}
+#endif
 
+
+/**
+ * Convert the low 8 bits of one value in 8 binary digits ending at out.
+ *
+ * The byte is copied in all the bytes of one word by a multiply, each
+ * byte keep one different bit that is moved in the bit 0.
+ */
+static void simdBin8(char * out,unsigned LONGLONG val,int upper)
+{
+	unsigned LONGLONG t = ((val & 0xFF) * SIMD_ONES) & 0x8040201008040201ULL;
+
+	t = (((t + SIMD_ONES * 0x7F) >> 7) & SIMD_ONES) + SIMD_ONES * '0';
+
+	simdStore(out,t);
+
+	(void)upper;
+}
+
+#if XCFG_FORMAT_SIMD == 2
+/**
+ * Convert one value in 16 hex digits ending at out, the nibbles are
+ * converted by one PSHUFB lookup and reversed by a second one.
+ */
+static void simdHex16(char * out,unsigned LONGLONG val,int upper)
+{
+	const __m128i mask = _mm_set1_epi8(0x0F);
+	const __m128i reverse = _mm_set_epi8(0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15);
+	const __m128i digits = upper ?
+		_mm_setr_epi8('0','1','2','3','4','5','6','7','8','9','A','B','C','D','E','F') :
+		_mm_setr_epi8('0','1','2','3','4','5','6','7','8','9','a','b','c','d','e','f');
+	__m128i v = _mm_set_epi32(0,0,(int)(unsigned)(val >> 32),(int)(unsigned)val);
+
+	v = _mm_unpacklo_epi8(_mm_and_si128(v,mask),_mm_and_si128(_mm_srli_epi16(v,4),mask));
+	v = _mm_shuffle_epi8(_mm_shuffle_epi8(digits,v),reverse);
+
+	_mm_storeu_si128((__m128i *)(out - 15),v);
+}
+
+#define simdHex		simdHex16
+#define SIMD_HEX	16
+#else
+#define simdHex		simdHex8
+#define SIMD_HEX	8
+#endif
+
+
+/**
+ * Convert a value in hex or binary one chunk of digits at time. The
+ * last chunk can write some digits before the field, they are in the
+ * buffer but not emitted.
+ *
+ * A chunk of 16 hex digits consume 64 bits, a shift not defined even
+ * on a long long : the value is shifted in two halves of SIMD_HEX * 2
+ * bits so no single shift reach the width of the type.
+ */
+#define U2P(name,type,value,shift) \
+static void name(struct param_s * param) \
+{ \
+	unsigned LONGLONG val = (type)param->values.value; \
+	char * out = param->out; \
+	int n = (bitLength(val) + (shift - 1)) / shift; \
+	if (n < param->prec) \
+		n = param->prec; \
+	param->length += n; \
+	param->out -= n; \
+	while (out > param->out) \
+	{ \
+		if (shift == 4) \
+		{ \
+			simdHex(out,val,param->flags & FLAG_UPPER); \
+			out -= SIMD_HEX; \
+			val >>= SIMD_HEX * 2; \
+			val >>= SIMD_HEX * 2; \
+		} \
+		else \
+		{ \
+			simdBin8(out,val,0); \
+			out -= 8; \
+			val >>= 8; \
+		} \
+	} \
+}
+
+U2P(ulong2bin,unsigned LONG,lvalue,1)
+U2P(ulong2hex,unsigned LONG,lvalue,4)
+#if XCFG_FORMAT_LONGLONG && !defined(XCFG_FORMAT_LONG_ARE_LONGLONG)
+U2P(ullong2bin,unsigned LONGLONG,llvalue,1)
+U2P(ullong2hex,unsigned LONGLONG,llvalue,4)
+#endif
+#undef U2P
+#endif
+
+
+/**
+ * Convert a value in a radix power of 2. The number of digits is
+ * computed from the number of bits so the loop has a fixed count.
+ */
+#define U2P(name,type,value,shift) \
+static void name(struct param_s * param) \
+{ \
+	const char * digits = param->flags & FLAG_UPPER ? ms_udigits : ms_digits; \
+	type val = param->values.value; \
+	char * out = param->out; \
+	int n = (bitLength(val) + (shift - 1)) / shift; \
+	if (n < param->prec) \
+		n = param->prec; \
+	param->length += n; \
+	param->out -= n; \
+	while (out > param->out) \
+	{ \
+		*out-- = digits[val & ((1 << shift) - 1)]; \
+		val >>= shift; \
+	} \
+}
+
+#if !XCFG_FORMAT_SIMD
+U2P(ulong2bin,unsigned LONG,lvalue,1)
+U2P(ulong2hex,unsigned LONG,lvalue,4)
+#endif
+U2P(ulong2oct,unsigned LONG,lvalue,3)
+#if XCFG_FORMAT_LONGLONG && !defined(XCFG_FORMAT_LONG_ARE_LONGLONG)
+#if !XCFG_FORMAT_SIMD
+U2P(ullong2bin,unsigned LONGLONG,llvalue,1)
+U2P(ullong2hex,unsigned LONGLONG,llvalue,4)
+#endif
+U2P(ullong2oct,unsigned LONGLONG,llvalue,3)
+#endif
+
+
+/**
+ * Convert a pointer in hex, the field has always 2 digits for
+ * each byte of the pointer.
+ */
+static void ptr2hex(struct param_s * param)
+{
+#if XCFG_FORMAT_SIMD
+	unsigned LONGLONG val = param->values.lvalue;
+	char * out = param->out;
+	int n;
+
+	for (n = sizeof(void *) * 2 ; n > 0 ; n -= SIMD_HEX)
+	{
+		simdHex(out,val,param->flags & FLAG_UPPER);
+		out -= SIMD_HEX;
+		val >>= SIMD_HEX * 2;
+		val >>= SIMD_HEX * 2;
+	}
+
+	/* n is minus the digits written before the field */
+	out -= n;
+#else
+	const char * digits = param->flags & FLAG_UPPER ? ms_udigits : ms_digits;
+	unsigned LONG val = param->values.lvalue;
+	char * out = param->out;
+	int n;
+
+	for (n = sizeof(void *) * 2 ; n ; n--)
+	{
+		*out-- = digits[val & 0x0F];
+		val >>= 4;
+	}
+#endif
+
+	param->length += sizeof(void *) * 2;
+	param->out = out;
+}
+
+
+/**
+ * Convert an unsigned long value in one string
+ *
+ * All parameter are in the passed structure
+ *
+ * @param prec		- Minimum precision
+ * @param lvalue	- Unsigned value
+ * @param radix		- Radix (Supported values 2/8/10/16)
+ *
+ * @param out		- Buffer with the converted value.
+ */
+static void ulong2a(struct param_s * param)
+{
+	switch (param->radix)
+	{
+		case	2:
+			ulong2bin(param);
+			break;
+		case	8:
+			ulong2oct(param);
+			break;
+		case	16:
+			ulong2hex(param);
+			break;
+		default:
+			ulong2dec(param);
+			break;
+	}
+}
+
+/**
+ * Compute the number of digits of an integer without converting it,
+ * used when the output is only measured.
+ *
+ * @param val	- Unsigned value
+ */
+static void ularge2len(struct param_s * param,ULARGE val)
+{
+	int n;
+
+	if (param->flags & FLAG_POINTER)
+	{
+		param->length += sizeof(void *) * 2;
+		return;
+	}
+
+	switch (param->radix)
+	{
+		case	2:
+			n = bitLength(val);
+			break;
+		case	8:
+			n = (bitLength(val) + 2) / 3;
+			break;
+		case	16:
+			n = (bitLength(val) + 3) / 4;
+			break;
+		default:
+			n = decDigits(val);
+			break;
+	}
+
+	if (n < param->prec)
+		n = param->prec;
+
+	param->length += n;
+}
+
+#if XCFG_FORMAT_LONGLONG
+#ifdef XCFG_FORMAT_LONG_ARE_LONGLONG
+#define	ullong2a	ulong2a
+#else
+static void ullong2a(struct param_s * param)
+{
+	switch (param->radix)
+	{
+		case	2:
+			ullong2bin(param);
+			break;
+		case	8:
+			ullong2oct(param);
+			break;
+		case	16:
+			ullong2hex(param);
+			break;
+		default:
+			ullong2dec(param);
+			break;
+	}
+}
+#endif
+#endif
+
+/**
+ * Printf like using variable arguments.
+ * 
+ * @param outchar - Pointer to the function to output one new char.
+ * @param arg	- Argument for the output function.
+ * @param fmt	- Format options for the list of parameters.
+ * @param ...	- Arguments
+ *
+ * @return The number of char emitted.
+ * 
+ * @see xvformat
+ */
+unsigned xformat(void (*outchar)(void *,char),void *arg,const char * fmt,...)
+{
+	va_list list;
+	unsigned count;
+
+	va_start(list,fmt);
+	count = xvformat(outchar,arg,fmt,list);
+	va_end(list);
+
+	(void)list;
+
+	return count;
+}
+
+
+/**
+ * Printf like using variable arguments and a function to emit a run of chars.
+ *
+ * @param write - Pointer to the function to output a run of chars.
+ * @param arg	- Argument for the output function.
+ * @param fmt	- Format options for the list of parameters.
+ * @param ...	- Arguments
+ *
+ * @return The number of char emitted.
+ *
+ * @see xvformat_write
+ */
+unsigned xformat_write(void (*write)(void *,const char *,size_t),void *arg,const char * fmt,...)
+{
+	va_list list;
+	unsigned count;
+
+	va_start(list,fmt);
+	count = xvformat_write(write,arg,fmt,list);
+	va_end(list);
+
+	(void)list;
+
+	return count;
+}
+
+
+/**
+ * Output function and argument used by xvformat to adapt one
+ * function that emit a single char to xvformat_write.
+ */
+struct outchar_s
+{
+	void	(*outchar)(void *arg,char);
+	void	*arg;
+};
+
+static void writeOutchar(void *arg,const char *p,size_t n)
+{
+	struct outchar_s * o = (struct outchar_s *)arg;
+
+	while (n-- > 0)
+	{
+		(*o->outchar)(o->arg,*p++);
+	}
+}
+
+
+/**
+ * Printf like format function using a function to emit one char.
+ *
+ * @param outchar - Pointer to the function to output one char.
+ * @param arg	- Argument for the output function.
+ * @param fmt	- Format options for the list of parameters.
+ * @param args	- List parameters.
+ *
+ * @return The number of char emitted.
+ *
+ * @see xvformat_write
+ */
+unsigned xvformat(void (*outchar)(void *,char),void *arg,const char * fmt,va_list args)
+{
+	struct outchar_s o;
+
+	o.outchar = outchar;
+	o.arg = arg;
+
+	return xvformat_write(writeOutchar,(void *)&o,fmt,args);
+}
+
+
+/**
+ * Word used to scan the literal text, it may alias any char.
+ */
+#if XCFG_FORMAT_SCAN == 1
+#if defined(__GNUC__)
+typedef unsigned long __attribute__((__may_alias__)) scanword_t;
+#else
+typedef unsigned long scanword_t;
+#endif
+
+#define SCAN_ONES	((scanword_t)-1 / 0xFF)
+#define SCAN_HIGHS	(SCAN_ONES * 0x80)
+#define SCAN_HASZERO(v)	(((v) - SCAN_ONES) & ~(v) & SCAN_HIGHS)
+#endif
+
+/**
+ * Find the end of the literal text.
+ *
+ * The aligned blocks after the terminating nul are read on purpose,
+ * see SCAN_NOASAN.
+ *
+ * @param s - Literal text
+ * @return Pointer to the next % or to the terminating nul char.
+ */
+SCAN_NOASAN static const char * scanLiteral(const char *s)
+{
+#if XCFG_FORMAT_SCAN == 2
+	const __m128i pct = _mm_set1_epi8('%');
+	const __m128i nul = _mm_setzero_si128();
+	__m128i v;
+	unsigned mask;
+
+	/*
+	 * Aligned loads never cross a page so the bytes after the
+	 * terminator can be read safely.
+	 */
+	mask = (unsigned)((size_t)s & 15);
+	s -= mask;
+	v = _mm_load_si128((const __m128i *)s);
+	v = _mm_or_si128(_mm_cmpeq_epi8(v,pct),_mm_cmpeq_epi8(v,nul));
+	mask = ((unsigned)_mm_movemask_epi8(v) >> mask) << mask;
+
+	while (mask == 0)
+	{
+		s += 16;
+		v = _mm_load_si128((const __m128i *)s);
+		v = _mm_or_si128(_mm_cmpeq_epi8(v,pct),_mm_cmpeq_epi8(v,nul));
+		mask = (unsigned)_mm_movemask_epi8(v);
+	}
+
+	while (!(mask & 1))
+	{
+		mask >>= 1;
+		s++;
+	}
+
+	return s;
+#else
+#if XCFG_FORMAT_SCAN == 1
+	const scanword_t *w;
+	scanword_t v;
+
+	while ((size_t)s & (sizeof(scanword_t) - 1))
+	{
+		if (*s == '%' || *s == 0)
+			return s;
+		s++;
+	}
+
+	/*
+	 * Aligned words never cross a page so the bytes after the
+	 * terminator can be read safely.
+	 */
+	for (w = (const scanword_t *)s ; ; w++)
+	{
+		v = *w;
+		if (SCAN_HASZERO(v) | SCAN_HASZERO(v ^ (SCAN_ONES * '%')))
+			break;
+	}
+
+	s = (const char *)w;
+#endif
+
+	while (*s != '%' && *s != 0)
+	{
+		s++;
+	}
+
+	return s;
+#endif
+}
+
+
+/**
+ * We do not want use any library function, the string is scanned
+ * with the same method of the literal text, reading on purpose after
+ * the nul in the same aligned block.
+ *
+ * @param s - C	 string
+ * @return The length of the string
+ */
+SCAN_NOASAN static unsigned xstrlen(const char *s)
+{
+	const char *i = s;
+#if XCFG_FORMAT_SCAN == 2
+	const __m128i nul = _mm_setzero_si128();
+	unsigned mask;
+
+	/* Aligned loads never cross a page */
+	mask = (unsigned)((size_t)i & 15);
+	i -= mask;
+	mask = ((unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128((const __m128i *)i),nul)) >> mask) << mask;
+
+	while (mask == 0)
+	{
+		i += 16;
+		mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128((const __m128i *)i),nul));
+	}
+
+	while (!(mask & 1))
+	{
+		mask >>= 1;
+		i++;
+	}
+#else
+#if XCFG_FORMAT_SCAN == 1
+	const scanword_t *w;
+
+	while ((size_t)i & (sizeof(scanword_t) - 1))
+	{
+		if (*i == 0)
+			return (unsigned)(i - s);
+		i++;
+	}
+
+	/* Aligned words never cross a page */
+	for (w = (const scanword_t *)i ; !SCAN_HASZERO(*w) ; w++)
+	{
+	}
+
+	i = (const char *)w;
+#endif
+
+	while (*i)
+	{
+		i++;
+	}
+#endif
+
+	return (unsigned)(i - s);
+}
+
+
+/**
+ * Length of a string limited to max chars, used when the precision is
+ * set : the chars after max are never read, except in the same aligned
+ * word, so the string need a nul only if it is shorter than max.
+ *
+ * @param s		- C	string or array of at least max chars
+ * @param max	- Maximum length
+ * @return The length of the string, at most max
+ */
+SCAN_NOASAN static unsigned xstrnlen(const char *s,unsigned max)
+{
+	unsigned n = 0;
+#if XCFG_FORMAT_SCAN == 2
+	const __m128i nul = _mm_setzero_si128();
+	const char *i = (const char *)((size_t)s & ~(size_t)15);
+	unsigned next = (unsigned)(i + 16 - s);
+	unsigned mask;
+
+	/* Aligned loads never cross a page */
+	mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128((const __m128i *)i),nul)) >> (16 - next);
+
+	while (mask == 0 && next < max)
+	{
+		n = next;
+		mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128((const __m128i *)(s + n)),nul));
+		next += 16;
+	}
+
+	if (mask == 0)
+		return max;
+
+	while (!(mask & 1))
+	{
+		mask >>= 1;
+		n++;
+	}
+#else
+#if XCFG_FORMAT_SCAN == 1
+	const scanword_t *w;
+
+	while ((size_t)(s + n) & (sizeof(scanword_t) - 1))
+	{
+		if (n >= max || s[n] == 0)
+			return n;
+		n++;
+	}
+
+	/* Aligned words never cross a page */
+	for (w = (const scanword_t *)(s + n) ; n < max && !SCAN_HASZERO(*w) ; w++)
+	{
+		n += sizeof(scanword_t);
+	}
+#endif
+
+	while (n < max && s[n])
+	{
+		n++;
+	}
+#endif
+
+	return n < max ? n : max;
+}
+
+
+#if XCFG_FORMAT_STATS || XCFG_FORMAT_CACHE
+#if XCFG_FORMAT_STATS
+typedef struct xformat_stats_s stats_t;
+#else
+/**
+ * Without XCFG_FORMAT_STATS the slots hold only the counters of the cache
+ */
+typedef struct
+{
+	unsigned long	cachehits;
+	unsigned long	cachemisses;
+} stats_t;
+#endif
+
+/**
+ * Slots of the counters aligned to one cache line, updated with relaxed
+ * load and store without read modify write.
+ */
+static union
+{
+	stats_t	s;
+	char	pad[(sizeof(stats_t) + 63) & ~63];
+} ms_stats[XCFG_FORMAT_STATS_SLOTS];
+
+#if defined(__GNUC__)
+#define SLOT_ADD(slot,field,n)		__atomic_store_n(&(slot)->field,__atomic_load_n(&(slot)->field,__ATOMIC_RELAXED) + (unsigned long)(n),__ATOMIC_RELAXED)
+#define STATS_LOAD(v)				__atomic_load_n(&(v),__ATOMIC_RELAXED)
+#else
+#define SLOT_ADD(slot,field,n)		((slot)->field += (unsigned long)(n))
+#define STATS_LOAD(v)				(v)
+#endif
+
+/**
+ * Return the counters of the calling thread
+ */
+static stats_t * statsSlot(void)
+{
+#if XCFG_FORMAT_TLS && XCFG_FORMAT_STATS_SLOTS > 1
+	static XCFG_FORMAT_THREAD stats_t * slot;
+	static unsigned next;
+
+	if (slot == 0)
+	{
+#if defined(__GNUC__)
+		slot = &ms_stats[__atomic_fetch_add(&next,1,__ATOMIC_RELAXED) % XCFG_FORMAT_STATS_SLOTS].s;
+#else
+		slot = &ms_stats[next++ % XCFG_FORMAT_STATS_SLOTS].s;
+#endif
+	}
+
+	return slot;
+#else
+	return &ms_stats[0].s;
+#endif
+}
+#endif
+
+#if XCFG_FORMAT_STATS
+#define STATS_ADD(param,field,n)	SLOT_ADD((param)->stats,field,n)
+#define STATS_CONV(param,c)			do { if ((unsigned)XFORMAT_STATS_INDEX(c) < XFORMAT_STATS_CONV) STATS_ADD(param,conv[XFORMAT_STATS_INDEX(c)],1); } while (0)
+#else
+#define STATS_ADD(param,field,n)	((void)(param))
+#define STATS_CONV(param,c)			((void)0)
+#endif
+
+
+/**
+ * True when the output is only counted, without output function and
+ * without destination buffer : the chars of the fields are not needed.
+ */
+#define MEASURE(param)	((param)->write == 0 && (param)->end == 0)
+
+
+/**
+ * Emit a run of chars to the output function or copy it in memory
+ * up to the end of the destination buffer.
+ */
+static void outWrite(struct param_s * param,const char *buffer,int len)
+{
+	char * d;
+	char * e;
+
+	param->count += (unsigned)len;
+
+	if (param->write != 0)
+	{
+		STATS_ADD(param,writes,1);
+		(*param->write)(param->arg,buffer,(size_t)len);
+		return;
+	}
+
+	d = param->buf;
+	e = param->end - d > len ? d + len : param->end;
+
+	while (d < e)
+	{
+		*d++ = *buffer++;
+	}
+
+	param->buf = d;
+}
+
+
+#if XCFG_FORMAT_IOV
+/**
+ * Blocks referenced by the padding of xformat_iov
+ */
+static const char ms_iovSpaces[] = "                                                                ";
+static const char ms_iovZeros[]  = "0000000000000000000000000000000000000000000000000000000000000000";
+
+
+/**
+ * Add one run to the list, merged with the last run if contiguous.
+ */
+static void iovAdd(struct xformat_iov_s * v,const char * p,size_t n)
+{
+	struct xformat_iovec_s * last = v->count ? &v->iov[v->count - 1] : 0;
+
+	if (last != 0 && (const char *)last->iov_base + last->iov_len == p)
+	{
+		last->iov_len += n;
+	}
+	else if (v->count < v->max)
+	{
+		v->iov[v->count].iov_base = (void *)p;
+		v->iov[v->count].iov_len = n;
+		v->count++;
+	}
+	else
+		v->truncated = 1;
+}
+
+
+/**
+ * Output function of xformat_iov, the chars are not stable and are
+ * copied in the arena.
+ */
+static void iovWrite(void * arg,const char * p,size_t n)
+{
+	struct xformat_iov_s * v = (struct xformat_iov_s *)arg;
+	char * d = v->arena + v->used;
+	size_t i;
+
+	if (n > v->size - v->used)
+	{
+		n = v->size - v->used;
+		v->truncated = 1;
+	}
+
+	for (i = 0 ; i < n ; i++)
+	{
+		d[i] = p[i];
+	}
+
+	v->used += n;
+	if (n)
+		iovAdd(v,d,n);
+}
+
+
+/**
+ * Emit a run of chars that remain valid after the call : with
+ * xformat_iov long runs are referenced and not copied.
+ */
+static void outRef(struct param_s * param,const char *buffer,int len)
+{
+	if (param->write == iovWrite && len >= XCFG_FORMAT_IOV_MIN)
+	{
+		param->count += (unsigned)len;
+		iovAdd((struct xformat_iov_s *)param->arg,buffer,(size_t)len);
+	}
+	else if (len > 0)
+		outWrite(param,buffer,len);
+}
+#else
+#define outRef(param,buffer,len)	outBuffer(param,buffer,len,0)
+#endif
+
+
+/**
+ * Emit a run of chars, in upper case if required, with one call
+ * to the output function for each block.
+ */
+static void outBuffer(struct param_s * param,const char *buffer,int len,unsigned  toupper)
+{
+	char block[16];
+	int i,n;
+	char c;
+
+	if (len <= 0)
+		return;
+
+	if (!toupper || MEASURE(param))
+	{
+		outWrite(param,buffer,len);
+		return;
+	}
+
+	while (len > 0)
+	{
+		n = len > (int)sizeof(block) ? (int)sizeof(block) : len;
+
+		for (i = 0; i < n ; i++)
+		{
+			c = buffer[i];
+
+			if (c >= 'a' && c <= 'z')
+			{
+				c = (char)(c - ('a' - 'A'));
+			}
+
+			block[i] = c;
+		}
+
+		outWrite(param,block,n);
+		buffer += n;
+		len -= n;
+	}
+}
+
+
+/**
+ * Emit the padding using blocks of spaces or zeros.
+ */
+static void outChars(struct param_s * param,char ch,int len)
+{
+	const char * block = ch == '0' ? ms_zeros : ms_spaces;
+	char * d;
+	char * e;
+	int n;
+
+	if (len <= 0)
+		return;
+
+	if (param->write == 0)
+	{
+		param->count += (unsigned)len;
+		d = param->buf;
+		e = param->end - d > len ? d + len : param->end;
+
+		while (d < e)
+		{
+			*d++ = ch;
+		}
+
+		param->buf = d;
+		return;
+	}
+
+#if XCFG_FORMAT_IOV
+	/* Long padding is referenced in runs of a static block */
+	if (param->write == iovWrite && len >= XCFG_FORMAT_IOV_MIN)
+	{
+		block = ch == '0' ? ms_iovZeros : ms_iovSpaces;
+		param->count += (unsigned)len;
+
+		while (len > 0)
+		{
+			n = len > (int)sizeof(ms_iovSpaces) - 1 ? (int)sizeof(ms_iovSpaces) - 1 : len;
+			iovAdd((struct xformat_iov_s *)param->arg,block,(size_t)n);
+			len -= n;
+		}
+
+		return;
+	}
+#endif
+
+	while (len > 0)
+	{
+		n = len > (int)sizeof(ms_spaces) - 1 ? (int)sizeof(ms_spaces) - 1 : len;
+		outRef(param,block,n);
+		len -= n;
+	}
+}
+
+
+#if XCFG_FORMAT_STATS
+/**
+ * Emit the padding of one field.
+ */
+static void outPad(struct param_s * param,char ch,int len)
+{
+	if (len > 0)
+		STATS_ADD(param,padding,len);
+	outChars(param,ch,len);
+}
+#else
+#define outPad(param,ch,len)	outChars(param,ch,len)
+#endif
+
+
+#if XCFG_FORMAT_FLOAT && XCFG_FORMAT_FLOAT_EXACT
+/**
+ * Decompose the floating point argument in mantissa and binary exponent
+ * using only integer operations on the IEEE-754 representation.
+ *
+ * @param param - The value is returned as param->values.llvalue * 2 ^ param->fexp
+ * @param value	- Floating point argument.
+ *
+ * @return FLOAT_FINITE, FLOAT_INF or FLOAT_NAN
+ */
+static char floatSplit(struct param_s * param,DOUBLE_ARGS arg)
+{
+#if XCFG_FORMAT_FLOAT_PREC
+	union
+	{
+		float		f;
+		xlimb_t		u;
+	} v;
+	unsigned LONGLONG mant;
+	int exp;
+
+	v.f = (float)arg;
+	mant = v.u & 0x7FFFFF;
+	exp = (int)((v.u >> 23) & 0xFF);
+
+	if (v.u & 0x80000000UL)
+		param->flags |= FLAG_MINUS;
+
+	if (exp == 0xFF)
+		return mant ? FLOAT_NAN : FLOAT_INF;
+
+	if (exp)
+	{
+		mant |= 0x800000;
+		exp -= 150;
+	}
+	else
+		exp = -149;
+#else
+	union
+	{
+		double				d;
+		unsigned LONGLONG	u;
+	} v;
+	unsigned LONGLONG mant;
+	int exp;
+
+	v.d = (double)arg;
+	mant = v.u & 0xFFFFFFFFFFFFFULL;
+	exp = (int)((v.u >> 52) & 0x7FF);
+
+	if (v.u >> 63)
+		param->flags |= FLAG_MINUS;
+
+	if (exp == 0x7FF)
+		return mant ? FLOAT_NAN : FLOAT_INF;
+
+	if (exp)
+	{
+		mant |= 0x10000000000000ULL;
+		exp -= 1075;
+	}
+	else
+		exp = -1074;
+#endif
+
+	param->values.llvalue = mant;
+	param->fexp = exp;
+
+	return FLOAT_FINITE;
+}
+
+
+/**
+ * Prepare the exact decimal expansion of mant * 2 ^ exp.
+ *
+ * If exp >= 0 the integer part is stored in a long long or, when it is
+ * too big, in base 1e9 in big. Otherwise the integer part fit in a long
+ * long and the fraction is stored left aligned in base 2^32 in big so
+ * each multiplication by 1e9 shift out of the top limb the next 9 digits.
+ */
+static void fdInit(struct fdigits_s * fd,unsigned LONGLONG mant,int exp)
+{
+	unsigned LONGLONG t;
+	xlimb_t carry;
+	int i,k;
+
+	fd->bpos = fd->blen = fd->bnz = 0;
+	fd->nbig = fd->lo = 0;
+	fd->ibig = 0;
+	fd->ipart = 0;
+
+	if (exp >= 0)
+	{
+		if (bitLength(mant) + exp <= (int)sizeof(unsigned LONGLONG) * 8)
+		{
+			fd->ipart = mant << exp;
+		}
+		else
+		{
+			/*
+			 * Integer part in base 1e9 multiplied by 2^29 at time
+			 */
+			for (fd->nbig = 0 ; mant ; fd->nbig++)
+			{
+				fd->big[fd->nbig] = (xlimb_t)(mant % LIMB_BASE10);
+				mant /= LIMB_BASE10;
+			}
+
+			while (exp > 0)
+			{
+				k = exp > 29 ? 29 : exp;
+				exp -= k;
+				carry = 0;
+
+				for (i = 0 ; i < fd->nbig ; i++)
+				{
+					t = ((unsigned LONGLONG)fd->big[i] << k) + carry;
+					fd->big[i] = (xlimb_t)(t % LIMB_BASE10);
+					carry = (xlimb_t)(t / LIMB_BASE10);
+				}
+
+				while (carry)
+				{
+					fd->big[fd->nbig++] = carry % LIMB_BASE10;
+					carry /= LIMB_BASE10;
+				}
+			}
+
+			fd->ibig = 1;
+			fd->next = fd->nbig - 1;
+			for (fd->izero = 0 ; fd->big[fd->izero] == 0 ; fd->izero++)
+			{
+			}
+		}
+	}
+	else
+	{
+		exp = -exp;
+
+		if (exp < (int)sizeof(unsigned LONGLONG) * 8)
+		{
+			fd->ipart = mant >> exp;
+			mant &= ((unsigned LONGLONG)1 << exp) - 1;
+		}
+
+		if (mant)
+		{
+			/*
+			 * Left align the fraction in nbig limbs
+			 */
+			fd->nbig = (exp + 31) / 32;
+			k = fd->nbig * 32 - exp;
+
+			for (i = 0 ; i < fd->nbig ; i++)
+			{
+				fd->big[i] = 0;
+			}
+
+			fd->big[0] = (xlimb_t)((mant << k) & 0xFFFFFFFFUL);
+			if (fd->nbig > 1)
+				fd->big[1] = (xlimb_t)(((mant << k) >> 32) & 0xFFFFFFFFUL);
+			if (fd->nbig > 2 && k)
+				fd->big[2] = (xlimb_t)(mant >> (64 - k));
+
+			while (fd->big[fd->lo] == 0)
+			{
+				fd->lo++;
+			}
+		}
+	}
+
+	if (fd->ibig)
+		fd->nint = (fd->nbig - 1) * 9 + decDigits(fd->big[fd->nbig - 1]);
+	else
+		fd->nint = decDigits(fd->ipart);
+
+	fd->ileft = fd->nint;
+}
+
+
+/**
+ * Check if all the digits not yet returned by fdNext are zero.
+ */
+static int fdZero(const struct fdigits_s * fd)
+{
+	if (fd->bpos < fd->bnz)
+		return 0;
+
+	if (fd->ileft)
+		return fd->ibig && fd->next < fd->izero;
+
+	return fd->ibig || fd->lo >= fd->nbig;
+}
+
+
+/**
+ * Return the next digit of the decimal expansion, first the digits of
+ * the integer part and then the digits of the fraction.
+ */
+static char fdNext(struct fdigits_s * fd)
+{
+	unsigned LONGLONG t;
+	xlimb_t carry;
+	char * out;
+	int i;
+
+	if (fd->bpos >= fd->blen)
+	{
+		out = fd->block + sizeof(fd->block) - 1;
+
+		if (fd->ileft && !fd->ibig)
+		{
+			fd->blen = fd->ileft;
+			ullong2pairs(out,fd->ipart);
+		}
+		else
+		{
+			if (fd->ileft)
+			{
+				carry = fd->big[fd->next--];
+				fd->blen = fd->ileft == fd->nint ? fd->nint - (fd->nbig - 1) * 9 : 9;
+			}
+			else
+			{
+				carry = 0;
+				if (!fd->ibig)
+				{
+					for (i = fd->lo ; i < fd->nbig ; i++)
+					{
+						t = (unsigned LONGLONG)fd->big[i] * LIMB_BASE10 + carry;
+						fd->big[i] = (xlimb_t)(t & 0xFFFFFFFFUL);
+						carry = (xlimb_t)(t >> 32);
+					}
+
+					while (fd->lo < fd->nbig && fd->big[fd->lo] == 0)
+					{
+						fd->lo++;
+					}
+				}
+				fd->blen = 9;
+			}
+
+			/* 9 digits with leading zero */
+			for (i = 0 ; i < 9 ; i += 2)
+			{
+				t = carry % 100;
+				carry /= 100;
+				out[-i] = ms_pairs[t * 2 + 1];
+				if (i < 8)
+					out[-i - 1] = ms_pairs[t * 2];
+			}
+		}
+
+		if (fd->ileft)
+			fd->ileft -= fd->blen;
+
+		fd->bpos = (int)sizeof(fd->block) - fd->blen;
+		fd->blen = (int)sizeof(fd->block);
+
+		for (fd->bnz = fd->blen ; fd->bnz > fd->bpos && fd->block[fd->bnz - 1] == '0' ; fd->bnz--)
+		{
+		}
+	}
+
+	return fd->block[fd->bpos++];
+}
+
+
+/**
+ * Skip the leading zeros of the expansion so the next digit returned by
+ * fdNext is the first significant digit.
+ *
+ * @return Decimal exponent of the first significant digit, 0 if the
+ * value is zero.
+ */
+static int fdStart(struct fdigits_s * fd)
+{
+	int x;
+
+	if (fd->nint)
+		return fd->nint - 1;
+
+	for (x = -1 ; !fdZero(fd) ; x--)
+	{
+		if (fdNext(fd) != '0')
+		{
+			fd->bpos--;
+			return x;
+		}
+	}
+
+	return 0;
+}
+
+
+/**
+ * Round the decimal expansion to n digits, half to even as the exact
+ * value is known. The first digits are saved in param->buffer and the
+ * rounding is applied to them.
+ *
+ * @param param - Parameters with the initialized expansion.
+ * @param n		- Number of digits to keep.
+ */
+static void fdRound(struct param_s * param,struct fdigits_s * fd,int n)
+{
+	char last = '0';
+	char c;
+	int i;
+
+	fd->ndig = 0;
+	fd->last9 = -1;
+	fd->lastnz = -1;
+	fd->roundup = 0;
+	fd->carry = 0;
+
+	for (i = 0 ; i < n ; i++)
+	{
+		if (fdZero(fd))
+			return;
+
+		c = fdNext(fd);
+		if (i < (int)sizeof(param->buffer))
+			param->buffer[i] = c;
+		if (c != '9')
+			fd->last9 = i;
+		if (c != '0')
+			fd->lastnz = i;
+		last = c;
+		fd->ndig = i + 1;
+	}
+
+	if (fdZero(fd))
+		return;
+
+	c = fdNext(fd);
+
+	if (c > '5' || (c == '5' && (!fdZero(fd) || ((last - '0') & 1))))
+	{
+		fd->roundup = 1;
+
+		if (fd->last9 < 0)
+		{
+			fd->carry = 1;
+			fd->lastnz = 0;
+		}
+		else
+		{
+			fd->lastnz = fd->last9;
+			if (fd->ndig <= (int)sizeof(param->buffer))
+			{
+				param->buffer[fd->last9]++;
+				for (i = fd->last9 + 1 ; i < fd->ndig ; i++)
+				{
+					param->buffer[i] = '0';
+				}
+			}
+		}
+	}
+}
+
+
+/**
+ * Emit the rounded digits from position from to position to, the digits
+ * must be emitted in order. When the digits do not fit in param->buffer
+ * the expansion is generated again.
+ */
+static void fdEmit(struct param_s * param,struct fdigits_s * fd,int from,int to)
+{
+	char chunk[16];
+	int n,i;
+	char c;
+
+	if (fd->ndig <= (int)sizeof(param->buffer))
+	{
+		n = to < fd->ndig ? to : fd->ndig;
+		if (from < n)
+		{
+			outBuffer(param,param->buffer + from,n - from,0);
+			from = n;
+		}
+	}
+	else
+	{
+		n = 0;
+		for (i = from ; i < to && i < fd->ndig ; i++)
+		{
+			c = fdNext(fd);
+			if (fd->roundup && i >= fd->last9)
+				c = i == fd->last9 ? (char)(c + 1) : '0';
+
+			chunk[n++] = c;
+			if (n == (int)sizeof(chunk))
+			{
+				outBuffer(param,chunk,n,0);
+				n = 0;
+			}
+		}
+
+		outBuffer(param,chunk,n,0);
+		from = i;
+	}
+
+	outChars(param,'0',to - from);
+}
+
+
+/**
+ * Emit the significant digits from position from to position to, when
+ * the rounding carried out of the first digit they are 1 and zeros.
+ */
+static void fdDigits(struct param_s * param,struct fdigits_s * fd,int from,int to)
+{
+	if (fd->carry)
+	{
+		if (from == 0 && to > 0)
+		{
+			outBuffer(param,"1",1,0);
+			from = 1;
+		}
+		outChars(param,'0',to - from);
+	}
+	else
+		fdEmit(param,fd,from,to);
+}
+
+
+#if XCFG_FORMAT_FLOAT_SHORTEST
+/**
+ * Collect n digits of mant * 2 ^ exp at the positions from 10 ^ top
+ * down, top is raised to the first digit of the value when it is lower.
+ *
+ * @return Position of the last not zero digit, n if there are not zero
+ * digits after the window.
+ */
+static int fdWindow(struct fdigits_s * fd,unsigned LONGLONG mant,int exp,int * top,char * d,int n)
+{
+	int x,j,last = -1;
+
+	fdInit(fd,mant,exp);
+	x = fdStart(fd);
+	if (*top < x)
+		*top = x;
+
+	/* fdNext return zeros after the end of the expansion */
+	for (j = 0 ; j < n ; j++)
+	{
+		d[j] = j < *top - x ? 0 : (char)(fdNext(fd) - '0');
+		if (d[j])
+			last = j;
+	}
+
+	return fdZero(fd) ? last : n;
+}
+
+
+/**
+ * Find the shortest digits that read back as the same floating point
+ * number. The exact expansions of the boundaries of the rounding
+ * interval give the first position where a number with fewer digits is
+ * inside the interval, then the value is rounded at that position and
+ * kept inside the interval. The boundaries are included when the
+ * mantissa is even as the reader round half to even.
+ *
+ * The digits are returned in param->buffer as by fdRound.
+ *
+ * @return Decimal exponent of the first digit.
+ */
+static int fdShortest(struct param_s * param,struct fdigits_s * fd)
+{
+	unsigned LONGLONG mant = param->values.llvalue;
+	unsigned LONGLONG hi,lo,mid;
+	char dp[SHORT_DIGITS],dm[SHORT_DIGITS],dv[SHORT_DIGITS];
+	int lastp,lastm,lastv;
+	int top;
+	int odd = (int)(mant & 1);
+	int found,t,n;
+
+	fd->carry = fd->roundup = 0;
+
+	if (mant == 0)
+	{
+		param->buffer[0] = '0';
+		fd->ndig = 1;
+		fd->lastnz = 0;
+		return 0;
+	}
+
+	for (n = SHORT_FAST ; ; n = SHORT_DIGITS)
+	{
+		top = INT_MIN;
+		lastp = fdWindow(fd,mant * 4 + 2,param->fexp - 2,&top,dp,n);
+		if (mant == FLOAT_HIDDEN && param->fexp > FLOAT_EMIN)
+			lastm = fdWindow(fd,mant * 4 - 1,param->fexp - 2,&top,dm,n);
+		else
+			lastm = fdWindow(fd,mant * 4 - 2,param->fexp - 2,&top,dm,n);
+		lastv = fdWindow(fd,mant,param->fexp,&top,dv,n);
+
+		hi = lo = mid = 0;
+		found = 0;
+		for (t = 0 ; !found && t < n - 1 ; )
+		{
+			hi = hi * 10 + (unsigned)dp[t];
+			lo = lo * 10 + (unsigned)dm[t];
+			mid = mid * 10 + (unsigned)dv[t];
+			t++;
+			found = lo + (lastm >= t || odd) <= hi - (lastp < t && odd);
+		}
+
+		if (found || n == SHORT_DIGITS)
+			break;
+	}
+
+	lo += lastm >= t || odd;
+	hi -= lastp < t && odd;
+
+	if (dv[t] > 5 || (dv[t] == 5 && (lastv > t || (mid & 1))))
+		mid++;
+
+	if (mid < lo)
+		mid = lo;
+	else if (mid > hi)
+		mid = hi;
+
+	n = decDigits(mid);
+	ullong2pairs(param->buffer + n - 1,mid);
+	t = top - t + n;
+
+	while (n > 1 && param->buffer[n - 1] == '0')
+	{
+		n--;
+	}
+
+	fd->ndig = n;
+	fd->lastnz = n - 1;
+
+	return t;
+}
+#endif
+
+
+/**
+ * Emit the field padding and the sign of a floating point number.
+ *
+ * @param param	- Parameters
+ * @param len	- Length of the field without the sign.
+ */
+static void outFloatSign(struct param_s * param,int len)
+{
+	char sign = 0;
+
+	if (param->flags & FLAG_MINUS)
+		sign = '-';
+	else if (param->flags & FLAG_PLUS)
+		sign = '+';
+	else if (param->flags & FLAG_BLANK)
+		sign = ' ';
+
+	if (sign)
+		len++;
+
+	param->width -= len;
+
+	if (param->flags & FLAG_LEFT)
+		param->pad = ' ';
+	else if (param->pad != '0')
+		outPad(param,' ',param->width);
+
+	if (sign)
+		outBuffer(param,&sign,1,0);
+
+	if (!(param->flags & FLAG_LEFT) && param->pad == '0')
+		outPad(param,'0',param->width);
+}
+
+
+/**
+ * Convert one floating point number with %e or %g from the significant
+ * digits, from the shortest representation when no precision is given
+ * and XCFG_FORMAT_FLOAT_SHORTEST is enabled.
+ *
+ * @param param	- Parameters with the value from floatSplit.
+ * @param g		- True for %g
+ */
+static void outFloatSig(struct param_s * param,struct fdigits_s * fd,char g)
+{
+	char exp[5];
+	int x,p,sig,frac,len,elen;
+
+#if XCFG_FORMAT_FLOAT_SHORTEST
+	if (!(param->flags & FLAG_PREC))
+	{
+		x = fdShortest(param,fd);
+		sig = fd->ndig;
+		p = g && sig < 6 ? 6 : sig;
+		if (param->flags & FLAG_PREFIX)
+			sig = p;
+	}
+	else
+#endif
+	{
+		p = param->prec + !g;
+		if (p == 0)
+			p = 1;
+
+		fdInit(fd,param->values.llvalue,param->fexp);
+		x = fdStart(fd);
+		fdRound(param,fd,p);
+		x += fd->carry;
+
+		sig = p;
+		if (g && !(param->flags & FLAG_PREFIX))
+			sig = fd->lastnz < 0 ? 1 : fd->lastnz + 1;
+	}
+
+	/* %g use the fixed notation when the exponent is small */
+	if (g && x < p && x >= -4)
+	{
+		elen = 0;
+		if (x >= 0)
+			frac = sig > x + 1 ? sig - x - 1 : 0;
+		else
+			frac = sig - x - 1;
+		len = (x >= 0 ? x + 1 : 1) + frac;
+	}
+	else
+	{
+		exp[0] = param->flags & FLAG_UPPER ? 'E' : 'e';
+		exp[1] = x < 0 ? '-' : '+';
+		if (x < 0)
+			x = -x;
+		elen = 2;
+		if (x >= 100)
+		{
+			exp[elen++] = (char)('0' + x / 100);
+		}
+		exp[elen++] = ms_pairs[(x % 100) * 2];
+		exp[elen++] = ms_pairs[(x % 100) * 2 + 1];
+		x = 0;
+		frac = sig - 1;
+		len = 1 + frac + elen;
+	}
+
+	if (frac || (param->flags & FLAG_PREFIX))
+		len++;
+
+	outFloatSign(param,len);
+
+	if (fd->ndig > (int)sizeof(param->buffer))
+	{
+		fdInit(fd,param->values.llvalue,param->fexp);
+		fdStart(fd);
+	}
+
+	if (x >= 0)
+	{
+		fdDigits(param,fd,0,x + 1);
+		if (frac || (param->flags & FLAG_PREFIX))
+			outBuffer(param,".",1,0);
+		fdDigits(param,fd,x + 1,x + 1 + frac);
+	}
+	else
+	{
+		outBuffer(param,"0.",2,0);
+		outChars(param,'0',-x - 1);
+		fdDigits(param,fd,0,frac + x + 1);
+	}
+
+	outBuffer(param,exp,elen,0);
+}
+
+
+/**
+ * Convert one floating point number with the exact decimal expansion,
+ * the result is correctly rounded at any precision and no floating point
+ * operation is used. The expansion is in the frame of this function,
+ * not inlined, so only the floating point conversions use its stack.
+ *
+ * @param param	- Parameters with the value from floatSplit.
+ * @param type	- FLOAT_FINITE, FLOAT_INF or FLOAT_NAN
+ * @param conv	- Conversion char f, e, E, g or G
+ */
+FLOAT_NOINLINE static void outFloat(struct param_s * param,char type,char conv)
+{
+	struct fdigits_s fd;
+	int nint,len;
+
+	if (type != FLOAT_FINITE)
+	{
+		param->pad = ' ';
+		outFloatSign(param,3);
+		outBuffer(param,type == FLOAT_INF ? ms_inf : ms_nan,3,(param->flags & FLAG_UPPER) != 0);
+	}
+	else if (conv != 'f')
+	{
+		outFloatSig(param,&fd,(char)(conv == 'g' || conv == 'G'));
+	}
+	else
+	{
+		fdInit(&fd,param->values.llvalue,param->fexp);
+		nint = fd.nint;
+		fdRound(param,&fd,nint + param->prec);
+
+		len = (nint ? nint : 1) + fd.carry * (nint != 0);
+		if (param->prec || (param->flags & FLAG_PREFIX))
+			len += param->prec + 1;
+
+		outFloatSign(param,len);
+
+		if (fd.ndig > (int)sizeof(param->buffer))
+			fdInit(&fd,param->values.llvalue,param->fexp);
+
+		if (fd.carry)
+		{
+			outBuffer(param,"1",1,0);
+			outChars(param,'0',nint);
+		}
+		else if (nint == 0)
+			outBuffer(param,"0",1,0);
+		else
+			fdEmit(param,&fd,0,nint);
+
+		if (param->prec || (param->flags & FLAG_PREFIX))
+			outBuffer(param,".",1,0);
+
+		if (fd.carry)
+			outChars(param,'0',param->prec);
+		else
+			fdEmit(param,&fd,nint,nint + param->prec);
+	}
+
+	if (param->flags & FLAG_LEFT)
+		outPad(param,' ',param->width);
+}
+#endif
+
+
+
+/*
+ * Lint want declare list as const but list is an obscured pointer so
+ * the warning is disabled.
+ */
+/*lint -save -e818 */
+
+
+/**
+ * Decode one conversion specifier and the literal text after it.
+ *
+ * The format string is walked with the formatStates machine starting
+ * from the % until the type char, if the machine returns to the normal
+ * state the specifier is not a conversion and the char that caused it
+ * is the first char of the literal text.
+ *
+ * @param fmt	- Format string pointing to the %.
+ * @param spec	- Decoded specifier, type is 0 if it is not a conversion.
+ *
+ * @return Pointer to the next % or to the terminating nul char.
+ */
+static const char * parseSpec(const char * fmt,struct xformat_spec_s * spec)
+{
+	char state = ST_NORMAL;
+	int i;
+	char c;
+
+	spec->type = 0;
+
+	while ((c = *fmt++) != 0)
+	{
 		if (c < ' ' || c > 'z')
 			i = (int)CH_OTHER;
 		else
-			i = formatStates[c - ' '] & 0x0F;
+			i = formatStates[c - ' '] & 0x0F;
+
+		state = (char)(formatStates[(i << 3) + state] >> 4);
+
+		switch (state)
+		{
+			default:
+			case	ST_NORMAL:
+				spec->type = 0;
+				spec->literal = fmt - 1;
+				fmt = scanLiteral(fmt);
+				spec->litlen = (unsigned)(fmt - spec->literal);
+				return fmt;
+
+			case	ST_PERCENT:
+				spec->flags = 0;
+				spec->width = spec->prec = 0;
+				spec->prefixlen = 0;
+				spec->radix = 10;
+				spec->pad = ' ';
+				break;
+
+			case	ST_WIDTH:
+				if (c == '*')
+					spec->width = SPEC_ARG;
+				else if (spec->width != SPEC_ARG)
+					spec->width = spec->width * 10 + (c - '0');
+				break;
+
+			case	ST_DOT:
+				/* A dot without digits is precision 0 */
+				spec->flags |= FLAG_PREC;
+				break;
+
+			case	ST_PRECIS:
+				spec->flags |= FLAG_PREC;
+				if (c == '*')
+					spec->prec = SPEC_ARG;
+				else if (spec->prec != SPEC_ARG)
+					spec->prec = spec->prec * 10 + (c - '0');
+				break;
+
+			case	ST_SIZE:
+				switch (c)
+				{
+					default:
+						break;
+					case 'z':
+						spec->flags &= (unsigned)~FLAG_TYPE_MASK;
+						spec->flags |= FLAG_TYPE_SIZEOF;
+						break;
+
+#if XCFG_FORMAT_LONG
+					case 'l':
+#if XCFG_FORMAT_LONGLONG
+						if ((spec->flags & FLAG_TYPE_MASK) == FLAG_TYPE_LONG)
+						{
+							spec->flags &= (unsigned)~FLAG_TYPE_MASK;
+							spec->flags |=  FLAG_TYPE_LONGLONG;
+						}
+						else
+						{
+							spec->flags &= (unsigned)~FLAG_TYPE_MASK;
+							spec->flags |= FLAG_TYPE_LONG;
+
+						}
+#else
+						spec->flags &= ~FLAG_TYPE_MASK;
+						spec->flags |= FLAG_TYPE_LONG;
+#endif
+						break;
+#endif
+
+				}
+				break;
+
+			case	ST_FLAG:
+				switch (c)
+				{
+					default:
+						break;
+					case  '-':
+						spec->flags |= FLAG_LEFT;
+						break;
+					case  '0':
+						spec->pad = '0';
+						break;
+					case ' ':
+						spec->flags |= FLAG_BLANK;
+						break;
+					case '#':
+						spec->flags |= FLAG_PREFIX;
+						break;
+					case '+':
+						spec->flags |= FLAG_PLUS;
+						break;
+				}
+				break;
+
+			case	ST_TYPE:
+				switch (c)
+				{
+					default:
+						break;
+
+						/*
+						 * Pointer upper case
+						 */
+					case	'P':
+						spec->flags |=  FLAG_UPPER;
+						/* no break */
+						/* lint -fallthrough */
+						/* fall through */
+
+						/*
+						 * Pointer
+						 */
+					case	'p':
+						spec->flags &= (unsigned)~FLAG_TYPE_MASK;
+						spec->flags |= FLAG_INTEGER | FLAG_TYPE_SIZEOF | FLAG_POINTER;
+						spec->radix = 16;
+						spec->prefix[0] = '-';
+						spec->prefix[1] = '>';
+						spec->prefixlen = 2;
+						break;
+
+						/*
+						 * Binary number
+						 */
+					case	'b':
+						spec->flags |= FLAG_INTEGER;
+						spec->radix = 2;
+						if (spec->flags & FLAG_PREFIX)
+						{
+							spec->prefix[0] = '0';
+							spec->prefix[1] = 'b';
+							spec->prefixlen = 2;
+						}
+						break;
+
+						/*
+						 * Octal number
+						 */
+					case	'o':
+						spec->flags |= FLAG_INTEGER;
+						spec->radix = 8;
+						if (spec->flags & FLAG_PREFIX)
+						{
+							spec->prefix[0] = '0';
+							spec->prefixlen = 1;
+						}
+						break;
+
+						/*
+						 * Hex number upper case letter.
+						 */
+					case	'X':
+						spec->flags |= FLAG_UPPER;
+						/* no break */
+						/* lint -fallthrough */
+						/* fall through */
+
+						/*
+						 * Hex number lower case
+						 */
+					case	'x':
+						spec->flags |= FLAG_INTEGER;
+						spec->radix = 16;
+						if (spec->flags & FLAG_PREFIX)
+						{
+							spec->prefix[0] = '0';
+							spec->prefix[1] = spec->flags & FLAG_UPPER ? 'X' : 'x';
+							spec->prefixlen = 2;
+						}
+						break;
+
+						/*
+						 * Integer number radix 10
+						 */
+					case	'd':
+					case	'i':
+						spec->flags |= FLAG_DECIMAL;
+						/* no break */
+						/* lint -fallthrough */
+						/* fall through */
+
+						/*
+						 * Unsigned number
+						 */
+					case	'u':
+						spec->flags |= FLAG_INTEGER;
+						break;
+
+						/*
+						 * Upper case string and char
+						 */
+					case	'S':
+					case	'C':
+					case	'V':
+						spec->flags |= FLAG_UPPER;
+						break;
+
+#if XCFG_FORMAT_FLOAT
+						/**
+						 * Floating point number, exponent upper case
+						 */
+					case 'E':
+					case 'G':
+						spec->flags |= FLAG_UPPER;
+						/* no break */
+						/* lint -fallthrough */
+						/* fall through */
+
+						/**
+						 * Floating point number
+						 */
+					case 'e':
+					case 'g':
+					case 'f':
+						if (!(spec->flags & FLAG_PREC))
+						{
+							spec->prec = 6;
+						}
+						break;
+#endif
+				}
+
+				spec->type = c;
+				spec->literal = fmt;
+				fmt = scanLiteral(fmt);
+				spec->litlen = (unsigned)(fmt - spec->literal);
+				return fmt;
+		}
+	}
+
+	/*
+	 * Format terminated inside one specifier
+	 */
+	spec->type = 0;
+	spec->literal = fmt - 1;
+	spec->litlen = 0;
+
+	return fmt - 1;
+}
+
+
+/**
+ * Decode all the specifiers of one format string.
+ *
+ * @see xformat_compile
+ */
+static unsigned compile(const char * fmt,struct xformat_spec_s * prog,unsigned size)
+{
+	unsigned n;
+
+	if (size < 2)
+		return 0;
+
+	prog[0].type = 0;
+	prog[0].literal = fmt;
+	fmt = scanLiteral(fmt);
+	prog[0].litlen = (unsigned)(fmt - prog[0].literal);
+
+	for (n = 1 ; *fmt ; n++)
+	{
+		if (n + 1 >= size)
+			return 0;
+
+		fmt = parseSpec(fmt,&prog[n]);
+	}
+
+	prog[n].type = 0;
+	prog[n].literal = 0;
+	prog[n].litlen = 0;
+
+	return n + 1;
+}
+
+
+#if XCFG_FORMAT_CACHE
+/**
+ * Cache of compiled format strings keyed by the format pointer.
+ *
+ * Each entry is protected by a sequence number, odd while one thread
+ * is writing it. A format not found in the cache replace the entry of
+ * its slot : the first thread that find the sequence even take it with
+ * a compare and swap, compile the format and publish it with a release
+ * store. Readers copy the program and use it only if the sequence did
+ * not change during the copy, all the fields are read and written with
+ * relaxed atomic operations as the copy can overlap one write.
+ *
+ * The length and a hash of the whole format are stored with the key and
+ * compared, so a buffer reused for a different format is compiled
+ * again. A format with too many specifiers is stored with an empty
+ * program and always parsed.
+ */
+struct cache_s
+{
+	unsigned					seq;
+	const char *				key;
+	unsigned					count;
+	unsigned					len;
+	unsigned long				hash;
+	struct xformat_spec_s		prog[XCFG_FORMAT_CACHE_SPECS];
+};
+
+static struct cache_s ms_cache[XCFG_FORMAT_CACHE];
+
+/**
+ * Word used to copy the programs, it may alias any field.
+ */
+typedef unsigned __attribute__((__may_alias__)) cacheword_t;
+
+typedef char cacheWordCheck[sizeof(struct xformat_spec_s) % sizeof(cacheword_t) == 0 ? 1 : -1];
+
+
+/**
+ * Length and FNV-1a hash of the format.
+ */
+static unsigned long cacheHash(const char * fmt,unsigned * len)
+{
+	unsigned long hash = 2166136261UL;
+	const char * s;
+
+	for (s = fmt ; *s ; s++)
+	{
+		hash = ((hash ^ (unsigned char)*s) * 16777619UL) & 0xFFFFFFFFUL;
+	}
+
+	*len = (unsigned)(s - fmt);
+
+	return hash;
+}
+
+
+/**
+ * Copy count specifiers with relaxed atomic loads and stores.
+ */
+static void cacheCopy(struct xformat_spec_s * dst,const struct xformat_spec_s * src,unsigned count)
+{
+	cacheword_t * d = (cacheword_t *)dst;
+	const cacheword_t * s = (const cacheword_t *)src;
+	unsigned i;
+
+	for (i = 0 ; i < count * (unsigned)(sizeof(struct xformat_spec_s) / sizeof(cacheword_t)) ; i++)
+	{
+		__atomic_store_n(&d[i],__atomic_load_n(&s[i],__ATOMIC_RELAXED),__ATOMIC_RELAXED);
+	}
+}
+
+
+/**
+ * Find the compiled program for one format string, the hits and the
+ * misses are counted in the slot of the calling thread.
+ *
+ * @param fmt	- Format string.
+ * @param prog	- Destination of the program, XCFG_FORMAT_CACHE_SPECS entries.
+ * @return prog or null if the format must be parsed.
+ */
+static const struct xformat_spec_s * cacheLookup(const char * fmt,struct xformat_spec_s * prog)
+{
+	struct cache_s * entry;
+	stats_t * stats = statsSlot();
+	unsigned long hash;
+	unsigned seq,count,len;
+
+	entry = &ms_cache[(((size_t)fmt >> 2) * 2654435761u) % XCFG_FORMAT_CACHE];
+	seq = __atomic_load_n(&entry->seq,__ATOMIC_ACQUIRE);
+	hash = cacheHash(fmt,&len);
+
+	if ((seq & 1) == 0 && __atomic_load_n(&entry->key,__ATOMIC_RELAXED) == fmt &&
+		__atomic_load_n(&entry->len,__ATOMIC_RELAXED) == len &&
+		__atomic_load_n(&entry->hash,__ATOMIC_RELAXED) == hash)
+	{
+		count = __atomic_load_n(&entry->count,__ATOMIC_RELAXED);
+		if (count > XCFG_FORMAT_CACHE_SPECS)
+			count = 0;
+
+		cacheCopy(prog,entry->prog,count);
+
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (__atomic_load_n(&entry->seq,__ATOMIC_RELAXED) == seq)
+		{
+			if (count == 0)
+			{
+				SLOT_ADD(stats,cachemisses,1);
+				return 0;
+			}
+
+			SLOT_ADD(stats,cachehits,1);
+			return prog;
+		}
+	}
+
+	SLOT_ADD(stats,cachemisses,1);
+
+	if ((seq & 1) == 0 &&
+		__atomic_compare_exchange_n(&entry->seq,&seq,seq + 1,0,__ATOMIC_ACQUIRE,__ATOMIC_RELAXED))
+	{
+		__atomic_thread_fence(__ATOMIC_RELEASE);
+		__atomic_store_n(&entry->key,fmt,__ATOMIC_RELAXED);
+		__atomic_store_n(&entry->len,len,__ATOMIC_RELAXED);
+		__atomic_store_n(&entry->hash,hash,__ATOMIC_RELAXED);
+
+		count = compile(fmt,prog,XCFG_FORMAT_CACHE_SPECS);
+		cacheCopy(entry->prog,prog,count);
+
+		__atomic_store_n(&entry->count,count,__ATOMIC_RELAXED);
+		__atomic_store_n(&entry->seq,seq + 2,__ATOMIC_RELEASE);
+
+		return count != 0 ? prog : 0;
+	}
+
+	return 0;
+}
+
+
+/**
+ * Read the hits and the misses of the cache of all the threads.
+ *
+ * @param hits		- Formats found in the cache.
+ * @param misses	- Formats parsed.
+ */
+void xformat_cache_stats(unsigned long * hits,unsigned long * misses)
+{
+	unsigned i;
+
+	*hits = *misses = 0;
+
+	for (i = 0 ; i < XCFG_FORMAT_STATS_SLOTS ; i++)
+	{
+		*hits += STATS_LOAD(ms_stats[i].s.cachehits);
+		*misses += STATS_LOAD(ms_stats[i].s.cachemisses);
+	}
+}
+#endif
+
+
+#if XCFG_FORMAT_DEFER
+/**
+ * Deferred records.
+ *
+ * One record hold the format pointer, the length of the record and the
+ * arguments with the type after the default promotion, each argument is
+ * aligned to its size. Strings are copied as length and bytes with the
+ * terminating nul. A record with a null format only skip to the end of
+ * the storage, when the space at the end is smaller than the header the
+ * skip is implicit.
+ *
+ * With XCFG_FORMAT_DEFER_FMT the bytes of the format with the nul are
+ * copied after the header and used by the replay, the format pointer
+ * only mark the record as valid.
+ */
+struct defer_s
+{
+	const char *	fmt;
+	unsigned		len;
+};
+
+union deferAlign_u
+{
+	long				l;
+	void *				p;
+#if XCFG_FORMAT_LONGLONG
+	unsigned LONGLONG	ll;
+#endif
+#if XCFG_FORMAT_FLOAT
+	DOUBLE_ARGS			d;
+#endif
+};
+
+#define DEFER_ALIGN		((unsigned)sizeof(union deferAlign_u))
+#define DEFER_HEADER	(((unsigned)sizeof(struct defer_s) + DEFER_ALIGN - 1) & ~(DEFER_ALIGN - 1))
+
+/**
+ * The positions are published with release / acquire ordering so the
+ * producer and the consumer can run on different threads.
+ */
+#if defined(__GNUC__)
+#define DEFER_LOAD(p)		__atomic_load_n(p,__ATOMIC_ACQUIRE)
+#define DEFER_STORE(p,v)	__atomic_store_n(p,v,__ATOMIC_RELEASE)
+#else
+#define DEFER_LOAD(p)		(*(volatile unsigned *)(p))
+#define DEFER_STORE(p,v)	(*(volatile unsigned *)(p) = (v))
+#endif
+
+/**
+ * True if the format is a copy in a deferred record and not a constant
+ */
+#if XCFG_FORMAT_DEFER_FMT
+#define FMT_COPY(param)		((param)->rec != 0)
+#endif
+
+
+/**
+ * Copy one argument in the record.
+ *
+ * @param out	- Record.
+ * @param pos	- Position in the record, updated.
+ * @param room	- Size available for the record.
+ * @param value	- Argument.
+ * @param size	- Size of the argument.
+ * @param align	- Alignment of the argument, power of 2.
+ *
+ * @return 0 if the argument do not fit.
+ */
+static int deferPut(char * out,unsigned * pos,unsigned room,const void * value,unsigned size,unsigned align)
+{
+	const char * s = (const char *)value;
+	unsigned p = (*pos + align - 1) & ~(align - 1);
+
+	if (p > room || room - p < size)
+		return 0;
+
+	*pos = p + size;
+	out += p;
+
+	while (size-- > 0)
+	{
+		*out++ = *s++;
+	}
+
+	return 1;
+}
+
+
+/**
+ * Build one record walking the format to learn the type of the arguments.
+ *
+ * @return Length of the record or 0 if it do not fit in room.
+ */
+static unsigned deferRecord(char * out,unsigned room,const char * fmt,va_list args)
+{
+	struct xformat_spec_s spec;
+	struct defer_s * rec = (struct defer_s *)out;
+	const char * start = fmt;
+	const char * str;
+	unsigned pos = DEFER_HEADER;
+	unsigned len;
+	int prec;
+	union
+	{
+		int					i;
+		long				l;
+		void *				p;
+		size_t				z;
+#if XCFG_FORMAT_LONGLONG
+		LONGLONG			ll;
+#endif
+#if XCFG_FORMAT_FLOAT
+		DOUBLE_ARGS			d;
+#endif
+	} v;
+
+	if (room < DEFER_HEADER)
+		return 0;
+
+#if XCFG_FORMAT_DEFER_FMT
+	if (!deferPut(out,&pos,room,fmt,xstrlen(fmt) + 1,1))
+		return 0;
+#endif
+
+	fmt = scanLiteral(fmt);
+
+	while (*fmt)
+	{
+		fmt = parseSpec(fmt,&spec);
+		if (spec.type == 0)
+			continue;
+
+		if (spec.width == SPEC_ARG)
+		{
+			v.i = va_arg(args,int);
+			if (!deferPut(out,&pos,room,&v.i,sizeof(v.i),sizeof(v.i)))
+				return 0;
+		}
+
+		prec = spec.prec;
+		if (spec.prec == SPEC_ARG)
+		{
+			v.i = va_arg(args,int);
+			if (!deferPut(out,&pos,room,&v.i,sizeof(v.i),sizeof(v.i)))
+				return 0;
+			prec = v.i;
+		}
+
+		switch (spec.type)
+		{
+			case	's':
+			case	'S':
+				str = va_arg(args,const char *);
+				if (str == 0)
+					str = ms_null;
+				if ((spec.flags & FLAG_PREC) && prec >= 0)
+					len = xstrnlen(str,(unsigned)prec);
+				else
+					len = xstrlen(str);
+				if (!deferPut(out,&pos,room,&len,sizeof(len),sizeof(len)) ||
+					!deferPut(out,&pos,room,str,len,1) ||
+					!deferPut(out,&pos,room,"",1,1))
+					return 0;
+				break;
+
+				/*
+				 * The view is copied up to the precision with a nul
+				 * followed by its length, a view longer than the ring
+				 * can not be stored.
+				 */
+			case	'v':
+			case	'V':
+				str = va_arg(args,const char *);
+				v.z = va_arg(args,size_t);
+				if (str == 0)
+				{
+					str = ms_null;
+					v.z = sizeof(ms_null) - 1;
+				}
+				if ((spec.flags & FLAG_PREC) && prec >= 0 && (size_t)prec < v.z)
+					v.z = (size_t)prec;
+				if (v.z > room)
+					return 0;
+				len = (unsigned)v.z;
+				if (!deferPut(out,&pos,room,&len,sizeof(len),sizeof(len)) ||
+					!deferPut(out,&pos,room,str,len,1) ||
+					!deferPut(out,&pos,room,"",1,1) ||
+					!deferPut(out,&pos,room,&v.z,sizeof(v.z),sizeof(v.z)))
+					return 0;
+				break;
+
+			case	'c':
+			case	'C':
+			case	'B':
+				v.i = va_arg(args,int);
+				if (!deferPut(out,&pos,room,&v.i,sizeof(v.i),sizeof(v.i)))
+					return 0;
+				break;
+
+#if XCFG_FORMAT_FLOAT
+			case	'f':
+			case	'e':
+			case	'E':
+			case	'g':
+			case	'G':
+				v.d = va_arg(args,DOUBLE_ARGS);
+				if (!deferPut(out,&pos,room,&v.d,sizeof(v.d),sizeof(v.d)))
+					return 0;
+				break;
+#endif
+
+			default:
+				if (!(spec.flags & FLAG_INTEGER))
+					break;
+
+				switch (spec.flags & FLAG_TYPE_MASK)
+				{
+					case FLAG_TYPE_SIZEOF:
+						v.p = va_arg(args,void *);
+						len = deferPut(out,&pos,room,&v.p,sizeof(v.p),sizeof(v.p));
+						break;
+					case FLAG_TYPE_LONG:
+						v.l = va_arg(args,long);
+						len = deferPut(out,&pos,room,&v.l,sizeof(v.l),sizeof(v.l));
+						break;
+#if XCFG_FORMAT_LONGLONG
+					case FLAG_TYPE_LONGLONG:
+						v.ll = va_arg(args,LONGLONG);
+						len = deferPut(out,&pos,room,&v.ll,sizeof(v.ll),sizeof(v.ll));
+						break;
+#endif
+					default:
+						v.i = va_arg(args,int);
+						len = deferPut(out,&pos,room,&v.i,sizeof(v.i),sizeof(v.i));
+						break;
+				}
+
+				if (!len)
+					return 0;
+				break;
+		}
+	}
+
+	pos = (pos + DEFER_ALIGN - 1) & ~(DEFER_ALIGN - 1);
+	if (pos > room)
+		return 0;
+
+	rec->fmt = start;
+	rec->len = pos;
+
+	return pos;
+}
+
+
+/**
+ * Build one record leaving the argument list unchanged.
+ */
+static unsigned deferTry(char * out,unsigned room,const char * fmt,va_list args)
+{
+#if XCFG_FORMAT_VA_COPY
+	va_list list;
+	unsigned len;
+
+	va_copy(list,args);
+	len = deferRecord(out,room,fmt,list);
+	va_end(list);
+
+	return len;
+#else
+	return deferRecord(out,room,fmt,args);
+#endif
+}
+
+
+/**
+ * Return the next argument of the deferred record.
+ */
+static const void * recArg(struct param_s * param,unsigned size)
+{
+	unsigned pos = (param->recpos + size - 1) & ~(size - 1);
+
+	param->recpos = pos + size;
+
+	return param->rec + pos;
+}
+
+
+/**
+ * Return the next string of the deferred record.
+ */
+static char * recString(struct param_s * param)
+{
+	unsigned len = *(const unsigned *)recArg(param,sizeof(unsigned));
+	const char * s = param->rec + param->recpos;
+
+	param->recpos += len + 1;
+
+	return (char *)s;
+}
+
+#define ARG_DEFER(type,next)	(param->rec != 0 ? *(const type *)recArg(param,sizeof(type)) : (next))
+#define ARG_DEFER_STRING(next)	(param->rec != 0 ? recString(param) : (next))
+#else
+#define ARG_DEFER(type,next)	(next)
+#define ARG_DEFER_STRING(next)	(next)
+#endif
+
+#ifndef FMT_COPY
+#define FMT_COPY(param)		0
+#endif
+
+#if XCFG_FORMAT_BATCH
+/**
+ * Return the next argument of the current row of the arrays.
+ */
+static const void * colArg(struct param_s * param,unsigned size)
+{
+	return (const char *)param->cols[param->col++] + param->row * size;
+}
+
+#define ARG_BATCH(type,next)	(param->cols != 0 ? *(type const *)colArg(param,sizeof(type)) : (next))
+#else
+#define ARG_BATCH(type,next)	(next)
+#endif
+
+#if XCFG_FORMAT_ARGS
+/**
+ * Return the next tagged argument, missing arguments are 0.
+ */
+static const struct xformat_arg_s * targNext(struct param_s * param)
+{
+	static const struct xformat_arg_s none;
+
+	if (param->tpos >= param->tcount)
+		return &none;
+
+	return &param->targ[param->tpos++];
+}
+
+
+/**
+ * Integer type of the next tagged argument.
+ */
+static unsigned targType(struct param_s * param)
+{
+	unsigned type = param->tpos < param->tcount ? param->targ[param->tpos].type : XFORMAT_ARG_INT;
+
+	switch (type)
+	{
+		case XFORMAT_ARG_INT:
+		case XFORMAT_ARG_UINT:
+			return FLAG_TYPE_INT;
+		case XFORMAT_ARG_LONG:
+		case XFORMAT_ARG_ULONG:
+			return FLAG_TYPE_LONG;
+		case XFORMAT_ARG_STRING:
+		case XFORMAT_ARG_POINTER:
+			return FLAG_TYPE_SIZEOF;
+		default:
+#if XCFG_FORMAT_LONGLONG
+			return FLAG_TYPE_LONGLONG;
+#else
+			return FLAG_TYPE_LONG;
+#endif
+	}
+}
+
+
+/**
+ * Return the next tagged argument as integer, floating point, pointer
+ * or string converting it from the type of the tag.
+ */
+static ULARGE targInteger(struct param_s * param)
+{
+	const struct xformat_arg_s * a = targNext(param);
+
+	switch (a->type)
+	{
+#if XCFG_FORMAT_FLOAT
+		case XFORMAT_ARG_DOUBLE:
+			return (ULARGE)(FLOAT_LONG)a->value.d;
+#endif
+		case XFORMAT_ARG_STRING:
+		case XFORMAT_ARG_POINTER:
+			return (ULARGE)(size_t)a->value.p;
+		default:
+			return (ULARGE)a->value.u;
+	}
+}
+
+#if XCFG_FORMAT_FLOAT
+static DOUBLE_ARGS targDouble(struct param_s * param)
+{
+	const struct xformat_arg_s * a = targNext(param);
+
+	switch (a->type)
+	{
+		case XFORMAT_ARG_DOUBLE:
+			return (DOUBLE_ARGS)a->value.d;
+		case XFORMAT_ARG_UINT:
+		case XFORMAT_ARG_ULONG:
+		case XFORMAT_ARG_ULLONG:
+			return (DOUBLE_ARGS)a->value.u;
+		case XFORMAT_ARG_STRING:
+		case XFORMAT_ARG_POINTER:
+			return 0;
+		default:
+			return (DOUBLE_ARGS)a->value.i;
+	}
+}
+#endif
+
+static void * targPointer(struct param_s * param)
+{
+	const struct xformat_arg_s * a = targNext(param);
+
+	if (a->type == XFORMAT_ARG_STRING || a->type == XFORMAT_ARG_POINTER)
+		return (void *)a->value.p;
+#if XCFG_FORMAT_FLOAT
+	if (a->type == XFORMAT_ARG_DOUBLE)
+		return 0;
+#endif
+
+	return (void *)(size_t)a->value.u;
+}
+
+static char * targString(struct param_s * param)
+{
+	const struct xformat_arg_s * a = targNext(param);
+
+	return a->type == XFORMAT_ARG_STRING || a->type == XFORMAT_ARG_POINTER ? (char *)a->value.s : 0;
+}
+
+#define ARG_TAGGED(get,next)	(param->targ != 0 ? (get) : (next))
+#else
+#define ARG_TAGGED(get,next)	(next)
+#endif
+
+#define VARG(type)		ARG_DEFER(type,ARG_BATCH(type,va_arg(args,type)))
+
+/**
+ * Read the next argument : integer, floating point, pointer or string
+ */
+#define ARG(type)		ARG_TAGGED((type)targInteger(param),VARG(type))
+#define ARG_DOUBLE()	ARG_TAGGED(targDouble(param),VARG(DOUBLE_ARGS))
+#define ARG_POINTER()	ARG_TAGGED(targPointer(param),VARG(void *))
+#define ARG_STRING()	ARG_TAGGED(targString(param),ARG_DEFER_STRING(ARG_BATCH(char *,va_arg(args,char *))))
+
+
+/**
+ * Format engine shared by all the entry points, the output function or
+ * the destination buffer must be already set in the parameters.
+ *
+ * The specifiers are decoded from fmt or taken from a compiled program
+ * when prog is not null.
+ */
+static void format(struct param_s * param,const char * fmt,const struct xformat_spec_s * prog,va_list _args)
+{
+	struct xformat_spec_s spec;
+	const struct xformat_spec_s * op;
+#if XCFG_FORMAT_CACHE
+	struct xformat_spec_s cached[XCFG_FORMAT_CACHE_SPECS];
+#endif
+	int zeros;
+	char c;
+
+#if XCFG_FORMAT_VA_COPY
+	va_list args;
+
+	va_copy(args,_args);
+#else
+#define args	_args
+#endif
+
+
+	param->count = 0;
+#if XCFG_FORMAT_STATS
+	param->stats = statsSlot();
+#endif
+
+#if XCFG_FORMAT_CACHE
+	if (prog == 0 && !FMT_COPY(param))
+	{
+		prog = cacheLookup(fmt,cached);
+	}
+#endif
+
+	if (prog != 0)
+	{
+		op = prog;
+	}
+	else
+	{
+		spec.type = 0;
+		spec.literal = fmt;
+		fmt = scanLiteral(fmt);
+		spec.litlen = (unsigned)(fmt - spec.literal);
+		op = &spec;
+	}
+
+	for (;;)
+	{
+		if (op->type != 0)
+		{
+			param->flags = op->flags;
+			param->width = op->width;
+			param->prec = op->prec;
+			param->radix = op->radix;
+			param->pad = op->pad;
+			param->prefixlen = op->prefixlen;
+			param->prefix[0] = op->prefix[0];
+			param->prefix[1] = op->prefix[1];
+			param->length = 0;
+			zeros = 0;
+
+			if (param->width == SPEC_ARG)
+				param->width = (int)ARG(int);
+
+			if (param->prec == SPEC_ARG)
+				param->prec = (int)ARG(int);
+
+			c = op->type;
+			STATS_CONV(param,c);
+
+			switch (c)
+			{
+				default:
+					break;
+
+					/*
+					 * Upper case string
+					 */
+				case	'S':
+					/* no break */
+					/* lint -fallthrough */
+					/* fall through */
+
+					/*
+					 * Normal string
+					 */
+				case	's':
+					param->out = ARG_STRING();
+					if (param->out == 0)
+						param->out = (char *)ms_null;
+					/* The precision is the maximum number of chars read */
+					if ((param->flags & FLAG_PREC) && param->prec >= 0)
+						param->length = (int)xstrnlen(param->out,(unsigned)param->prec);
+					else
+						param->length = (int)xstrlen(param->out);
+#if XCFG_FORMAT_IOV
+					if (c == 's')
+						param->flags |= FLAG_REF;
+#endif
+					break;
+
+					/*
+					 * Upper case string view
+					 */
+				case	'V':
+					/* no break */
+					/* lint -fallthrough */
+					/* fall through */
+
+					/*
+					 * String view, pointer and size_t length without nul
+					 */
+				case	'v':
+					param->out = ARG_STRING();
+					param->values.lvalue = (unsigned LONG)ARG(size_t);
+					if (param->out == 0)
+					{
+						param->out = (char *)ms_null;
+						param->values.lvalue = sizeof(ms_null) - 1;
+					}
+					if ((param->flags & FLAG_PREC) && param->prec >= 0 && (unsigned LONG)param->prec < param->values.lvalue)
+						param->values.lvalue = (unsigned LONG)param->prec;
+					param->length = (int)param->values.lvalue;
+#if XCFG_FORMAT_IOV
+					if (c == 'v')
+						param->flags |= FLAG_REF;
+#endif
+					break;
+
+					/*
+					 * Upper case char
+					 */
+				case	'C':
+					/* no break */
+					/* lint -fallthrough */
+					/* fall through */
+
+					/*
+					 * Char
+					 */
+				case	'c':
+					param->out = param->buffer;
+					param->buffer[0] = (char)ARG(int);
+					param->length = 1;
+					break;
+
+#if XCFG_FORMAT_FLOAT
+					/**
+					 * Floating point number
+					 */
+				case 'f':
+#if XCFG_FORMAT_FLOAT_EXACT
+				case 'e':
+				case 'E':
+				case 'g':
+				case 'G':
+					if (param->prec < 0)
+					{
+						param->prec = 6;
+						param->flags &= (unsigned)~FLAG_PREC;
+					}
+					param->flags |= FLAG_FLOAT;
+					c = floatSplit(param,ARG_DOUBLE());
+					break;
+#else
+					/*
+					 * Without the exact conversion %e and %g are printed as %f
+					 */
+				case 'e':
+				case 'E':
+				case 'g':
+				case 'G':
+					param->values.dvalue =  xpow10(param->prec);
+					param->dbl = (DOUBLE)ARG_DOUBLE();
+
+#if XCFG_FORMAT_FLOAT_SPECIAL
+					param->out = (char *)checkFloat(param->dbl);
+					if (param->out != 0)
+					{
+						param->length = (int)xstrlen(param->out);
+
+					}
+					else
+					{
+#endif
+
+					if (param->dbl < 0)
+					{
+						param->flags |= FLAG_MINUS;
+						param->dbl		-= (DOUBLE)0.5 / param->values.dvalue;
+						param->iPart	   = (FLOAT_LONG)param->dbl;
+						param->dbl		-=	(DOUBLE)(FLOAT_LONG)param->iPart;
+						param->dbl		 = - param->dbl;
+					}
+					else
+					{
+						param->dbl += (DOUBLE)0.5 / param->values.dvalue;
+						param->iPart = (FLOAT_LONG)param->dbl;
+						param->dbl -= (DOUBLE)param->iPart;
+					}
+
+					param->dbl *= param->values.dvalue;
+
+					param->values.lvalue = (unsigned LONG)param->dbl;
+
+					param->out = param->buffer + sizeof(param->buffer) - 1;
+					param->radix = 10;
+					if (param->prec)
+					{
+						ulong2a(param);
+						*param->out -- = '.';
+						param->length ++;
+					}
+					param->flags |= FLAG_INTEGER | FLAG_BUFFER |
+								   FLAG_DECIMAL | FLAG_VALUE  | FLOAT_TYPE;
+
+					param->prec = 0;
+					param->values.FLOAT_VALUE  = (unsigned FLOAT_LONG)param->iPart;
+
+#if XCFG_FORMAT_FLOAT_SPECIAL
+					}
+#endif
+					break;
+#endif
+#endif
+
+					/**
+					 * Boolean value
+					 */
+				case 'B':
+					if (ARG(int) != 0)
+						param->out = (char*)ms_true;
+					else
+						param->out = (char*)ms_false;
+
+					param->length = (int)xstrlen(param->out);
+					break;
+
+
+			}
+
+#if XCFG_FORMAT_FLOAT && XCFG_FORMAT_FLOAT_EXACT
+			if (param->flags & FLAG_FLOAT)
+			{
+				outFloat(param,c,op->type);
+			}
+			else
+#endif
+			{
+				/*
+				 * Process integer number
+				 */
+				if (param->flags & FLAG_INTEGER)
+				{
+					if (param->prec == 0)
+						param->prec = 1;
+
+					if (!(param->flags & FLAG_VALUE))
+					{
+#if XCFG_FORMAT_ARGS
+						/* The size of tagged arguments is given by the tag */
+						if (param->targ != 0 && !(param->flags & FLAG_POINTER))
+						{
+							param->flags &= (unsigned)~FLAG_TYPE_MASK;
+							param->flags |= targType(param);
+						}
+#endif
+						switch (param->flags & FLAG_TYPE_MASK)
+						{
+							case FLAG_TYPE_SIZEOF:
+								param->values.lvalue = (unsigned LONG)ARG_POINTER();
+								break;
+							case FLAG_TYPE_LONG:
+								if (param->flags & FLAG_DECIMAL)
+									param->values.lvalue = (LONG)ARG(long);
+								else
+									param->values.lvalue = (unsigned LONG)ARG(unsigned long);
+								break;
+							
+							case FLAG_TYPE_INT:
+								if (param->flags & FLAG_DECIMAL)
+									param->values.lvalue = (LONG)ARG(int);
+								else
+									param->values.lvalue = (unsigned LONG)ARG(unsigned int);
+								break;
+	#if XCFG_FORMAT_LONGLONG
+							case FLAG_TYPE_LONGLONG:
+								param->values.llvalue = (LONGLONG)ARG(long long);
+								break;
+	#endif
+						}
+
+					}
+
+					if (param->flags & FLAG_PREFIX)
+					{
+	#if XCFG_FORMAT_LONGLONG
+						if ((param->flags & FLAG_TYPE_MASK) == FLAG_TYPE_LONGLONG ? param->values.llvalue == 0 : param->values.lvalue == 0)
+	#else
+						if (param->values.lvalue == 0)
+	#endif
+							param->prefixlen = 0;
+					}
+
+
+					/*
+					 * Manage signed integer
+					 */
+					if (param->flags & FLAG_DECIMAL)
+					{
+	#if XCFG_FORMAT_LONGLONG
+						if ((param->flags & FLAG_TYPE_MASK) == FLAG_TYPE_LONGLONG)
+						{
+							if ((LONGLONG)param->values.llvalue < 0)
+							{
+								param->values.llvalue = ~param->values.llvalue + 1;
+								param->flags |= FLAG_MINUS;
+							}
+						}
+						else 
+						{
+	#endif
+							if ((LONG)param->values.lvalue < 0)
+							{
+								param->values.lvalue = ~param->values.lvalue + 1;
+								param->flags |= FLAG_MINUS;
+
+							}
+	#if XCFG_FORMAT_LONGLONG
+						}
+	#endif
+						if (!(param->flags & FLAG_MINUS)  && (param->flags & FLAG_BLANK))
+						{
+							param->prefix[0] = ' ';
+							param->prefixlen = 1;
+						}
+					}
+
+					if ((param->flags & FLAG_BUFFER) == 0)
+					{
+						param->out = param->buffer + sizeof(param->buffer) - 1;
+					}
+
+					/*
+					 * The digits and the sign must fit in the buffer, the
+					 * leading zeros of a greater precision are emitted
+					 * later as a run of chars. The pointers have always
+					 * the same digits.
+					 */
+					if (param->prec > (int)sizeof(param->buffer) - 2 && !(param->flags & FLAG_POINTER))
+					{
+						zeros = param->prec;
+						param->prec = (int)sizeof(param->buffer) - 2;
+					}
+
+
+					if (MEASURE(param))
+					{
+	#if XCFG_FORMAT_LONGLONG
+						if ((param->flags & FLAG_TYPE_MASK) == FLAG_TYPE_LONGLONG)
+							ularge2len(param,param->values.llvalue);
+						else
+	#endif
+							ularge2len(param,param->values.lvalue);
+					}
+					else if (param->flags & FLAG_POINTER)
+						ptr2hex(param);
+	#if XCFG_FORMAT_LONGLONG
+					else if ((param->flags & FLAG_TYPE_MASK) == FLAG_TYPE_LONGLONG)
+						ullong2a(param);
+	#endif
+					else
+						ulong2a(param);
+
+					param->out++;
+
+					if (zeros)
+					{
+						zeros -= param->length;
+						if (zeros < 0)
+							zeros = 0;
+					}
+
+					/*
+					 * Check if a sign is required
+					 */
+					if (param->flags & (FLAG_MINUS|FLAG_PLUS))
+					{
+						c = param->flags & FLAG_MINUS ? '-' : '+';
+
+						if (param->pad == '0')
+						{
+							param->prefixlen = 1;
+							param->prefix[0] = c;
+						}
+						else
+						{
+							*--param->out = c;
+							param->length++;
+						}
+					}
+
+
+				}
+				else
+				{
+					if (param->width && param->length > param->width)
+					{
+						param->length = param->width;
+					}
+
+				}
+
+				/*
+				 * Now width contain the size of the pad
+				 */
+				param->width -= (param->length + param->prefixlen + zeros);
+
+				outBuffer(param,param->prefix,param->prefixlen,0);
+				if (!(param->flags & FLAG_LEFT))
+					outPad(param,param->pad,param->width);
+				if (zeros)
+				{
+					/* The sign in the buffer precede the leading zeros */
+					if ((param->flags & (FLAG_MINUS|FLAG_PLUS)) && param->pad != '0')
+					{
+						outBuffer(param,param->out,1,0);
+						param->out++;
+						param->length--;
+					}
+					outChars(param,'0',zeros);
+				}
+				/* Integer are converted with the right case of letter */
+				if (param->flags & FLAG_REF)
+					outRef(param,param->out,param->length);
+				else
+					outBuffer(param,param->out,param->length,(param->flags & (FLAG_UPPER|FLAG_INTEGER)) == FLAG_UPPER);
+				if (param->flags & FLAG_LEFT)
+					outPad(param,param->pad,param->width);
+			}
+		}
+
+		outRef(param,op->literal,(int)op->litlen);
+
+		if (prog != 0)
+		{
+			op++;
+			if (op->literal == 0)
+				break;
+		}
+		else
+		{
+			if (*fmt == 0)
+				break;
+			fmt = parseSpec(fmt,&spec);
+		}
+	}
+
+	STATS_ADD(param,calls,1);
+	STATS_ADD(param,bytes,param->count);
+
+#if XCFG_FORMAT_VA_COPY
+	va_end(args);
+#endif
+}
+
+#if !XCFG_FORMAT_VA_COPY
+#undef args
+#endif
+
+
+/**
+ * Read the arguments from the va_list and not from another source.
+ */
+static void argsFromList(struct param_s * param)
+{
+#if XCFG_FORMAT_DEFER
+	param->rec = 0;
+#endif
+#if XCFG_FORMAT_BATCH
+	param->cols = 0;
+#endif
+#if XCFG_FORMAT_ARGS
+	param->targ = 0;
+#endif
+	(void)param;
+}
+
+
+#if XCFG_FORMAT_DEFER || XCFG_FORMAT_BATCH || XCFG_FORMAT_ARGS
+/**
+ * Run the format engine when the arguments are read from a record,
+ * from arrays or from tagged values, the va_list is not used.
+ */
+static void formatNoList(struct param_s * param,const char * fmt,const struct xformat_spec_s * prog,...)
+{
+	va_list list;
+
+	va_start(list,prog);
+	format(param,fmt,prog,list);
+	va_end(list);
+
+	(void)list;
+}
+#endif
+
+
+/**
+ * Run one format with the parameters in param and a function to emit
+ * runs of chars, common to all the functions with and without context.
+ */
+static unsigned formatWrite(struct param_s * param,void (*write)(void *,const char *,size_t),void *arg,const char * fmt,const struct xformat_spec_s * prog,va_list args)
+{
+	param->write = write;
+	param->arg = arg;
+	argsFromList(param);
+
+	format(param,fmt,prog,args);
+
+	return param->count;
+}
+
+
+/**
+ * Run one format with the parameters in param writing in memory.
+ */
+static unsigned formatMemory(struct param_s * param,char *buf,size_t size,const char * fmt,va_list args)
+{
+	param->write = 0;
+	param->buf = buf;
+	param->end = size ? buf + size - 1 : buf;
+	argsFromList(param);
+
+	format(param,fmt,0,args);
+
+	if (size)
+		*param->buf = 0;
+
+	if (param->count > (size ? size - 1 : 0))
+		STATS_ADD(param,truncations,1);
+
+	return param->count;
+}
+
+
+/**
+ * The parameters must fit in the storage of one context.
+ */
+typedef char ctxSizeCheck[sizeof(struct param_s) <= sizeof(struct xformat_ctx_s) ? 1 : -1];
+
+#define CTX_PARAM(ctx)	((struct param_s *)(void *)(ctx)->u.storage)
+
+
+/**
+ * Printf like format function.
+ *
+ * General format :
+ * 
+ * %[width][.precision][flags]type
+ *
+ * - width Is the minimum size of the field.
+ * 
+ * - precision Is the maximum size of the field, with %s the string is
+ *   read only up to the precision and can be without nul.
+ * 
+ * Supported flags :
+ * 
+ * - l	With integer number the argument will be of type long.
+ * - ll With integer number the argument will be of type long long.
+ * -	Space for positive integer a space will be added before.
+ * - z	Compatible with C99 the argument is size_t (aka sizeof(void *))
+ * - +	A + sign prefix positive number.
+ * - #	A prefix will be printed (o for octal,0x for hex,0b for binary)
+ * - 0	Value will be padded with zero (default is spacwe)
+ * - -	Left justify as default filed have rigth justification.
+ * 
+ * Supported type :
+ * 
+ * - s	Null terminated string of char.
+ * - S	Null terminated string of char in upper case.
+ * - v	String of char with the length in a size_t argument after it.
+ * - V	String of char with the length in upper case.
+ * - i	Integer number.
+ * - d	Integer number.
+ * - u	Unsigned number.
+ * - x	Unsigned number in hex.
+ * - X	Unsigned number in hex upper case.
+ * - b	Binary number
+ * - o	Octal number
+ * - p	Pointer will be emitted with the prefix ->
+ * - P	Pointer in upper case letter.
+ * - f	Floating point number.
+ * - e	Floating point number in exponential notation.
+ * - E	Same as e with the exponent in upper case.
+ * - g	Floating point number in fixed or exponential notation by the exponent.
+ * - G	Same as g with the exponent in upper case.
+ * - B	Boolean value printed as True / False.
+ *
+ * Literal text and the converted fields are emitted in runs, the output
+ * function is called once for each run and never for a single char of it.
+ *
+ * @param write - Pointer to the function to output a run of chars.
+ * @param arg	- Argument for the output function.
+ * @param fmt	- Format options for the list of parameters.
+ * @param args	- List parameters.
+ *
+ * @return The number of char emitted.
+ */
+unsigned xvformat_write(void (*write)(void *,const char *,size_t),void *arg,const char * fmt,va_list args)
+{
+	XCFG_FORMAT_STATIC struct param_s param;
+
+	return formatWrite(&param,write,arg,fmt,0,args);
+}
+
+
+/**
+ * Printf like format function writing directly in memory.
+ *
+ * The output is truncated to size - 1 chars and always terminated
+ * by a nul char if size is not zero, as vsnprintf do.
+ *
+ * @param buf	- Destination buffer.
+ * @param size	- Size of the destination buffer.
+ * @param fmt	- Format options for the list of parameters.
+ * @param args	- List parameters.
+ *
+ * @return The number of char that would be emitted without truncation.
+ */
+unsigned xvsnformat(char *buf,size_t size,const char * fmt,va_list args)
+{
+	XCFG_FORMAT_STATIC struct param_s param;
+
+	return formatMemory(&param,buf,size,fmt,args);
+}
+
+
+/**
+ * Printf like format function writing directly in memory.
+ *
+ * @param buf	- Destination buffer.
+ * @param size	- Size of the destination buffer.
+ * @param fmt	- Format options for the list of parameters.
+ * @param ...	- Arguments
+ *
+ * @return The number of char that would be emitted without truncation.
+ *
+ * @see xvsnformat
+ */
+unsigned xsnformat(char *buf,size_t size,const char * fmt,...)
+{
+	va_list list;
+	unsigned count;
+
+	va_start(list,fmt);
+	count = xvsnformat(buf,size,fmt,list);
+	va_end(list);
+
+	(void)list;
+
+	return count;
+}
+
+/**
+ * Compute the exact number of char emitted by one format without
+ * emitting them.
+ *
+ * No output function is called and no memory is written : literal
+ * text, padding and strings are counted by their length and the
+ * integer fields by their number of digits, without converting them.
+ * The result can be used to reserve the space before the format.
+ *
+ * @param fmt	- Format options for the list of parameters.
+ * @param args	- List parameters.
+ *
+ * @return The number of char that would be emitted.
+ */
+unsigned xvformat_measure(const char * fmt,va_list args)
+{
+	XCFG_FORMAT_STATIC struct param_s param;
+
+	param.write = 0;
+	param.buf = 0;
+	param.end = 0;
+	argsFromList(&param);
+
+	format(&param,fmt,0,args);
+
+	return param.count;
+}
+
+
+/**
+ * Compute the exact number of char emitted by one format.
+ *
+ * @param fmt	- Format options for the list of parameters.
+ * @param ...	- Arguments
+ *
+ * @return The number of char that would be emitted.
+ *
+ * @see xvformat_measure
+ */
+unsigned xformat_measure(const char * fmt,...)
+{
+	va_list list;
+	unsigned count;
+
+	va_start(list,fmt);
+	count = xvformat_measure(fmt,list);
+	va_end(list);
+
+	(void)list;
+
+	return count;
+}
+
+
+/**
+ * Printf like format function using a context and a function to emit
+ * runs of chars.
+ *
+ * @param ctx	- Formatting context, used by one thread at time.
+ * @param write - Pointer to the function to output a run of chars.
+ * @param arg	- Argument for the output function.
+ * @param fmt	- Format options for the list of parameters.
+ * @param args	- List parameters.
+ *
+ * @return The number of char emitted.
+ *
+ * @see xvformat_write
+ */
+unsigned xvformat_ctx(struct xformat_ctx_s * ctx,void (*write)(void *,const char *,size_t),void *arg,const char * fmt,va_list args)
+{
+	return formatWrite(CTX_PARAM(ctx),write,arg,fmt,0,args);
+}
+
+
+/**
+ * Printf like format function using a context and a function to emit
+ * runs of chars.
+ *
+ * @param ctx	- Formatting context, used by one thread at time.
+ * @param write - Pointer to the function to output a run of chars.
+ * @param arg	- Argument for the output function.
+ * @param fmt	- Format options for the list of parameters.
+ * @param ...	- Arguments
+ *
+ * @return The number of char emitted.
+ *
+ * @see xvformat_ctx
+ */
+unsigned xformat_ctx(struct xformat_ctx_s * ctx,void (*write)(void *,const char *,size_t),void *arg,const char * fmt,...)
+{
+	va_list list;
+	unsigned count;
+
+	va_start(list,fmt);
+	count = xvformat_ctx(ctx,write,arg,fmt,list);
+	va_end(list);
+
+	(void)list;
+
+	return count;
+}
+
+
+/**
+ * Printf like format function using a context and writing in memory.
+ *
+ * @param ctx	- Formatting context, used by one thread at time.
+ * @param buf	- Destination buffer.
+ * @param size	- Size of the destination buffer.
+ * @param fmt	- Format options for the list of parameters.
+ * @param args	- List parameters.
+ *
+ * @return The number of char that would be emitted without truncation.
+ *
+ * @see xvsnformat
+ */
+unsigned xvsnformat_ctx(struct xformat_ctx_s * ctx,char *buf,size_t size,const char * fmt,va_list args)
+{
+	return formatMemory(CTX_PARAM(ctx),buf,size,fmt,args);
+}
+
+
+/**
+ * Printf like format function using a context and writing in memory.
+ *
+ * @param ctx	- Formatting context, used by one thread at time.
+ * @param buf	- Destination buffer.
+ * @param size	- Size of the destination buffer.
+ * @param fmt	- Format options for the list of parameters.
+ * @param ...	- Arguments
+ *
+ * @return The number of char that would be emitted without truncation.
+ *
+ * @see xvsnformat_ctx
+ */
+unsigned xsnformat_ctx(struct xformat_ctx_s * ctx,char *buf,size_t size,const char * fmt,...)
+{
+	va_list list;
+	unsigned count;
 
-		param.state = (char)(formatStates[(i << 3) + param.state] >> 4);
+	va_start(list,fmt);
+	count = xvsnformat_ctx(ctx,buf,size,fmt,list);
+	va_end(list);
 
+	(void)list;
 
-		switch (param.state)
-		{
-			default:
-			case	ST_NORMAL:
-				(*outchar)(arg,c);
-				param.count++;
-				break;
+	return count;
+}
 
-			case	ST_PERCENT:
-				param.flags = param.length = param.prefixlen = param.width = param.prec = 0;
-				param.pad = ' ';
-				break;
 
-			case	ST_WIDTH:
-				if (c == '*')
-					param.width = (int)va_arg(args,int);
-				else
-					param.width = param.width * 10 + (c - '0');
-				break;
+/**
+ * Compile a format string in a program of decoded specifiers.
+ *
+ * The program refer to the literal text in the format string so
+ * the format string must remain valid as long as the program.
+ *
+ * @param fmt	- Format string.
+ * @param prog	- Storage for the program.
+ * @param size	- Number of specifiers in the storage.
+ *
+ * @return The number of specifiers used or 0 if the storage is too small.
+ */
+unsigned xformat_compile(const char * fmt,struct xformat_spec_s * prog,unsigned size)
+{
+	return compile(fmt,prog,size);
+}
 
-			case	ST_DOT:
-				break;
 
-			case	ST_PRECIS:
-				param.flags |= FLAG_PREC;
-				if (c == '*')
-					param.prec = (int)va_arg(args,int);
-				else
-					param.prec = param.prec * 10 + (c - '0');
-				break;
+/**
+ * Printf like format function executing a compiled format.
+ *
+ * @param prog	- Program returned by xformat_compile.
+ * @param write - Pointer to the function to output a run of chars.
+ * @param arg	- Argument for the output function.
+ * @param args	- List parameters.
+ *
+ * @return The number of char emitted.
+ */
+unsigned xvformat_compiled(const struct xformat_spec_s * prog,void (*write)(void *,const char *,size_t),void *arg,va_list args)
+{
+	XCFG_FORMAT_STATIC struct param_s param;
 
-			case	ST_SIZE:
-				switch (c)
-				{
-					default:
-						break;
-					case 'z':
-						param.flags &= (unsigned)~FLAG_TYPE_MASK;
-						param.flags |= FLAG_TYPE_SIZEOF;
-						break;
+	return formatWrite(&param,write,arg,0,prog,args);
+}
 
-#if XCFG_FORMAT_LONG
-					case 'l':
-#if XCFG_FORMAT_LONGLONG
-						if ((param.flags & FLAG_TYPE_MASK) == FLAG_TYPE_LONG)
-						{
-							param.flags &= (unsigned)~FLAG_TYPE_MASK;
-							param.flags |=  FLAG_TYPE_LONGLONG;
-						}
-						else
-						{
-							param.flags &= (unsigned)~FLAG_TYPE_MASK;
-							param.flags |= FLAG_TYPE_LONG;
 
-						}
+/**
+ * Printf like format function executing a compiled format.
+ *
+ * @param prog	- Program returned by xformat_compile.
+ * @param write - Pointer to the function to output a run of chars.
+ * @param arg	- Argument for the output function.
+ * @param ...	- Arguments
+ *
+ * @return The number of char emitted.
+ *
+ * @see xvformat_compiled
+ */
+unsigned xformat_compiled(const struct xformat_spec_s * prog,void (*write)(void *,const char *,size_t),void *arg,...)
+{
+	va_list list;
+	unsigned count;
+
+	va_start(list,arg);
+	count = xvformat_compiled(prog,write,arg,list);
+	va_end(list);
+
+	(void)list;
+
+	return count;
+}
+
+#if XCFG_FORMAT_BATCH
+/**
+ * Apply one format to many rows of arguments stored in arrays.
+ *
+ * Each argument is taken from one array, indexed by the position of
+ * the argument in the format, holding one element for each row of the
+ * type the specifier read from the argument list : int for %d %c %*,
+ * long for %ld, long long for %lld, size_t for %zu, double for %f %e %g
+ * and char * for %s, %v read one array of char * and one of size_t. The
+ * format is parsed only once.
+ *
+ * @param fmt		- Format options for the arguments of one row.
+ * @param columns	- One array for each argument of the format.
+ * @param rows		- Number of rows.
+ * @param write		- Pointer to the function to output a run of chars.
+ * @param arg		- Argument for the output function.
+ *
+ * @return The number of char emitted.
+ */
+unsigned xformat_batch(const char * fmt,const void * const columns[],size_t rows,void (*write)(void *,const char *,size_t),void *arg)
+{
+	XCFG_FORMAT_STATIC struct param_s param;
+	XCFG_FORMAT_STATIC struct xformat_spec_s prog[XCFG_FORMAT_BATCH_SPECS];
+	const struct xformat_spec_s * op = 0;
+	unsigned count = 0;
+
+	if (compile(fmt,prog,XCFG_FORMAT_BATCH_SPECS) != 0)
+		op = prog;
+
+	param.write = write;
+	param.arg = arg;
+	argsFromList(&param);
+	param.cols = columns;
+
+	for (param.row = 0 ; param.row < rows ; param.row++)
+	{
+		param.col = 0;
+		formatNoList(&param,fmt,op);
+		count += param.count;
+	}
+
+	return count;
+}
+#endif
+
+#if XCFG_FORMAT_STATS
+/**
+ * Read the sum of the counters of all the threads, the counters are
+ * updated while they are read and the snapshot is not atomic.
+ *
+ * @param stats	- Destination of the counters.
+ */
+void xformat_stats(struct xformat_stats_s * stats)
+{
+	const unsigned long * src;
+	unsigned long * dst = (unsigned long *)stats;
+	unsigned i,j;
+
+	for (j = 0 ; j < sizeof(struct xformat_stats_s) / sizeof(unsigned long) ; j++)
+	{
+		dst[j] = 0;
+	}
+
+	for (i = 0 ; i < XCFG_FORMAT_STATS_SLOTS ; i++)
+	{
+		src = (const unsigned long *)&ms_stats[i].s;
+		for (j = 0 ; j < sizeof(struct xformat_stats_s) / sizeof(unsigned long) ; j++)
+		{
+			dst[j] += STATS_LOAD(src[j]);
+		}
+	}
+}
+
+
+/**
+ * Clear all the counters, the events counted at the same time by
+ * other threads can be lost.
+ */
+void xformat_stats_reset(void)
+{
+	unsigned long * dst;
+	unsigned i,j;
+
+	for (i = 0 ; i < XCFG_FORMAT_STATS_SLOTS ; i++)
+	{
+		dst = (unsigned long *)&ms_stats[i].s;
+		for (j = 0 ; j < sizeof(struct xformat_stats_s) / sizeof(unsigned long) ; j++)
+		{
+#if defined(__GNUC__)
+			__atomic_store_n(&dst[j],0,__ATOMIC_RELAXED);
 #else
-						param.flags &= ~FLAG_TYPE_MASK;
-						param.flags |= FLAG_TYPE_LONG;
+			dst[j] = 0;
 #endif
-						break;
+		}
+	}
+}
 #endif
 
-				}
-				break;
 
-			case	ST_FLAG:
-				switch (c)
-				{
-					default:
-						break;
-					case  '-':
-						param.flags |= FLAG_LEFT;
-						break;
-					case  '0':
-						param.pad = '0';
-						break;
-					case ' ':
-						param.flags |= FLAG_BLANK;
-						break;
-					case '#':
-						param.flags |= FLAG_PREFIX;
-						break;
-					case '+':
-						param.flags |= FLAG_PLUS;
-						break;
-				}
-				break;
+#if XCFG_FORMAT_IOV
+/**
+ * Initialize the destination of xformat_iov.
+ *
+ * @param v		- Destination to initialize.
+ * @param iov	- Array of runs.
+ * @param max	- Number of runs in the array.
+ * @param arena	- Storage for the converted chars.
+ * @param size	- Size of the arena.
+ */
+void xformat_iov_init(struct xformat_iov_s * v,struct xformat_iovec_s * iov,unsigned max,char * arena,size_t size)
+{
+	v->iov = iov;
+	v->max = max;
+	v->count = 0;
+	v->arena = arena;
+	v->size = size;
+	v->used = 0;
+	v->truncated = 0;
+}
 
-			case	ST_TYPE:
-				switch (c)
-				{
-					default:
-						param.length = 0;
-						break;
 
-						/*
-						 * Pointer upper case
-						 */
-					case	'P':
-						param.flags |=  FLAG_UPPER;
-						/* no break */
-						/* lint -fallthrough */
-						/* fall through */
+/**
+ * Printf like format function building a list of runs for writev.
+ *
+ * Literal text, strings and padding of at least XCFG_FORMAT_IOV_MIN
+ * chars are referenced in place, the padding in a static block, the
+ * format and the strings must be valid until the runs are written. The other chars are copied in the
+ * arena. The runs are added after the runs already in v.
+ *
+ * @param v		- Destination initialized by xformat_iov_init.
+ * @param fmt	- Format options for the list of parameters.
+ * @param args	- List parameters.
+ *
+ * @return The number of char emitted, v->truncated is set if some
+ * chars are not in the runs.
+ */
+unsigned xvformat_iov(struct xformat_iov_s * v,const char * fmt,va_list args)
+{
+	XCFG_FORMAT_STATIC struct param_s param;
 
-						/*
-						 * Pointer 
-						 */
-					case	'p':
-						param.flags &= (unsigned)~FLAG_TYPE_MASK;
-						param.flags |= FLAG_INTEGER | FLAG_TYPE_SIZEOF;
-						param.radix = 16;
-						param.prec = sizeof(void *) * 2;
-						param.prefix[0] = '-';
-						param.prefix[1] = '>';
-						param.prefixlen = 2;
-						break;
+	return formatWrite(&param,iovWrite,(void *)v,fmt,0,args);
+}
 
-						/*
-						 * Binary number
-						 */
-					case	'b':
-						param.flags |= FLAG_INTEGER;
-						param.radix = 2;
-						if (param.flags & FLAG_PREFIX)
-						{
-							param.prefix[0] = '0';
-							param.prefix[1] = 'b';
-							param.prefixlen = 2;
-						}
-						break;
 
-						/*
-						 * Octal number
-						 */
-					case	'o':
-						param.flags |= FLAG_INTEGER;
-						param.radix = 8;
-						if (param.flags & FLAG_PREFIX)
-						{
-							param.prefix[0] = '0';
-							param.prefixlen = 1;
-						}
-						break;
+/**
+ * Printf like format function building a list of runs for writev.
+ *
+ * @param v		- Destination initialized by xformat_iov_init.
+ * @param fmt	- Format options for the list of parameters.
+ * @param ...	- Arguments
+ *
+ * @return The number of char emitted.
+ *
+ * @see xvformat_iov
+ */
+unsigned xformat_iov(struct xformat_iov_s * v,const char * fmt,...)
+{
+	va_list list;
+	unsigned count;
+
+	va_start(list,fmt);
+	count = xvformat_iov(v,fmt,list);
+	va_end(list);
+
+	(void)list;
+
+	return count;
+}
+#endif
+
+#if XCFG_FORMAT_ARENA
+/**
+ * Move the string being formatted in a chunk with at least n more
+ * bytes, the next chunk is used again if large enough or a new chunk
+ * is allocated before it.
+ *
+ * @return 0 if the chunk can not be allocated.
+ */
+static int arenaGrow(struct xformat_arena_s * a,size_t n)
+{
+	struct xformat_chunk_s * c = a->last != 0 ? a->last->next : a->chunks;
+	size_t len = a->used - a->start;
+	size_t need = len + n + 1;
+	char * d;
+	size_t i;
+
+	if (c == 0 || c->size < need)
+	{
+		if (a->alloc == 0)
+			return 0;
+
+		/* Room for the rest of a long string in a multiple of the chunk */
+		need = (need / XCFG_FORMAT_ARENA_CHUNK + 1) * XCFG_FORMAT_ARENA_CHUNK;
+
+		c = (struct xformat_chunk_s *)(*a->alloc)(a->arg,0,sizeof(struct xformat_chunk_s) + need);
+		if (c == 0)
+			return 0;
+
+		c->size = need;
+		if (a->last != 0)
+		{
+			c->next = a->last->next;
+			a->last->next = c;
+		}
+		else
+		{
+			c->next = a->chunks;
+			a->chunks = c;
+		}
+	}
+
+	d = (char *)(c + 1);
+	for (i = 0 ; i < len ; i++)
+	{
+		d[i] = a->buf[a->start + i];
+	}
+
+	a->last = c;
+	a->buf = d;
+	a->size = c->size;
+	a->start = 0;
+	a->used = len;
+
+	return 1;
+}
+
+
+/**
+ * Output function of xaformat, one byte is always left for the
+ * terminator.
+ */
+static void arenaWrite(void * arg,const char * p,size_t n)
+{
+	struct xformat_arena_s * a = (struct xformat_arena_s *)arg;
+	char * d;
+	size_t i;
+
+	if (a->failed)
+		return;
+
+	if (n >= a->size - a->used && !arenaGrow(a,n))
+	{
+		a->failed = 1;
+		return;
+	}
+
+	d = a->buf + a->used;
+	for (i = 0 ; i < n ; i++)
+	{
+		d[i] = p[i];
+	}
+
+	a->used += n;
+}
+
+
+/**
+ * Initialize one arena for xaformat.
+ *
+ * @param a		- Arena.
+ * @param buf	- First chunk, can be null.
+ * @param size	- Size of the first chunk.
+ * @param alloc	- Function called with ptr null to allocate one chunk of
+ *				  size bytes and with size 0 to release the chunk ptr,
+ *				  null if the arena can not grow.
+ * @param arg	- Argument of alloc.
+ */
+void xformat_arena_init(struct xformat_arena_s * a,char * buf,size_t size,void * (*alloc)(void *arg,void *ptr,size_t size),void *arg)
+{
+	a->alloc = alloc;
+	a->arg = arg;
+	a->first = buf;
+	a->firstsize = buf != 0 ? size : 0;
+	a->chunks = 0;
+	xformat_arena_reset(a);
+}
+
+
+/**
+ * Release all the strings of one arena, the chunks are kept and used
+ * again by the next strings.
+ *
+ * @param a		- Arena.
+ */
+void xformat_arena_reset(struct xformat_arena_s * a)
+{
+	a->last = 0;
+	a->buf = a->first;
+	a->size = a->firstsize;
+	a->used = 0;
+	a->start = 0;
+}
+
+
+/**
+ * Release all the strings and return the chunks to the allocator.
+ *
+ * @param a		- Arena.
+ */
+void xformat_arena_free(struct xformat_arena_s * a)
+{
+	struct xformat_chunk_s * c;
+
+	while (a->chunks != 0)
+	{
+		c = a->chunks;
+		a->chunks = c->next;
+		(*a->alloc)(a->arg,(void *)c,0);
+	}
+
+	xformat_arena_reset(a);
+}
 
-						/*
-						 * Hex number upper case letter.
-						 */
-					case	'X':
-						param.flags |= FLAG_UPPER;
-						/* no break */
-						/* lint -fallthrough */
-						/* fall through */
 
-						/*
-						 * Hex number lower case
-						 */
-					case	'x':
-						param.flags |= FLAG_INTEGER;
-						param.radix = 16;
-						if (param.flags & FLAG_PREFIX)
-						{
-							param.prefix[0] = '0';
-							param.prefix[1] = 'x';
-							param.prefixlen = 2;
-						}
-						break;
+/**
+ * Printf like format function allocating the string in one arena.
+ *
+ * The string is contiguous and nul terminated, when it does not fit in
+ * the current chunk it is moved in the next one.
+ *
+ * @param a		- Arena initialized by xformat_arena_init.
+ * @param fmt	- Format options for the list of parameters.
+ * @param args	- List parameters.
+ *
+ * @return The string and its length, str is null when the arena is
+ * full and can not be grown.
+ */
+struct xformat_str_s xvaformat(struct xformat_arena_s * a,const char * fmt,va_list args)
+{
+	XCFG_FORMAT_STATIC struct param_s param;
+	struct xformat_str_s s;
 
-						/*
-						 * Integer number radix 10
-						 */
-					case	'd':
-					case	'i':
-						param.flags |= FLAG_DECIMAL;
-						/* no break */
-						/* lint -fallthrough */
-						/* fall through */
-						
-						/*
-						 * Unsigned number
-						 */
-					case	'u':
-						param.flags |= FLAG_INTEGER;
-						param.radix = 10;
-						break;
+	a->start = a->used;
+	a->failed = 0;
 
-						/*
-						 * Upper case string
-						 */
-					case	'S':
-						param.flags |= FLAG_UPPER;
-						/* no break */
-						/* lint -fallthrough */
-						/* fall through */
+	formatWrite(&param,arenaWrite,(void *)a,fmt,0,args);
 
-						/*
-						 * Normal string
-						 */
-					case	's':
-						param.out = va_arg(args,char *);
-						if (param.out == 0)
-							param.out = (char *)ms_null;
-						param.length = (int)xstrlen(param.out);
-						break;
+	if (a->failed || (a->used >= a->size && !arenaGrow(a,0)))
+	{
+		a->used = a->start;
+		s.str = 0;
+		s.len = 0;
+		return s;
+	}
 
-						/*
-						 * Upper case char
-						 */
-					case	'C':
-						param.flags |= FLAG_UPPER;
-						/* no break */
-						/* lint -fallthrough */
-						/* fall through */
+	a->buf[a->used] = 0;
+	s.str = a->buf + a->start;
+	s.len = a->used - a->start;
+	a->used++;
 
-						/*
-						 * Char
-						 */
-					case	'c':
-						param.out = param.buffer;
-						param.buffer[0] = (char)va_arg(args,int);
-						param.length = 1;
-						break;
+	return s;
+}
 
-#if XCFG_FORMAT_FLOAT
-						/**
-						 * Floating point number
-						 */
-					case 'f':
-						if (!(param.flags & FLAG_PREC))
-						{
-							param.prec = 6;
-						}
 
-						param.values.dvalue =  xpow10(param.prec);
-						param.dbl = (DOUBLE)va_arg(args,DOUBLE_ARGS);
+/**
+ * Printf like format function allocating the string in one arena.
+ *
+ * @param a		- Arena initialized by xformat_arena_init.
+ * @param fmt	- Format options for the list of parameters.
+ * @param ...	- Arguments
+ *
+ * @return The string and its length.
+ *
+ * @see xvaformat
+ */
+struct xformat_str_s xaformat(struct xformat_arena_s * a,const char * fmt,...)
+{
+	va_list list;
+	struct xformat_str_s s;
+
+	va_start(list,fmt);
+	s = xvaformat(a,fmt,list);
+	va_end(list);
 
-#if XCFG_FORMAT_FLOAT_SPECIAL
-						param.out = (char *)checkFloat(param.dbl);
-						if (param.out != 0)
-						{
-							param.length = (int)xstrlen(param.out);
+	(void)list;
 
-						}
-						else
-						{
+	return s;
+}
 #endif
 
-						if (param.dbl < 0)
-						{
-							param.flags |= FLAG_MINUS;
-							param.dbl		-= (DOUBLE)0.5 / param.values.dvalue;
-							param.iPart	   = (FLOAT_LONG)param.dbl;
-							param.dbl		-=	(DOUBLE)(FLOAT_LONG)param.iPart;
-							param.dbl		 = - param.dbl;
-						}
-						else
-						{
-							param.dbl += (DOUBLE)0.5 / param.values.dvalue;
-							param.iPart = (FLOAT_LONG)param.dbl;
-							param.dbl -= (DOUBLE)param.iPart;
-						}
+#if XCFG_FORMAT_ARGS
+/**
+ * Printf like format function reading the arguments from an array of
+ * tagged values.
+ *
+ * The type of each argument is given by its tag and not by the size
+ * modifier of the specifier, %d print a long long argument as long long,
+ * and the missing arguments are read as 0.
+ *
+ * @param write - Pointer to the function to output a run of chars.
+ * @param arg	- Argument for the output function.
+ * @param fmt	- Format options for the list of parameters.
+ * @param args	- Tagged arguments.
+ * @param count	- Number of arguments.
+ *
+ * @return The number of char emitted.
+ */
+unsigned xformat_args(void (*write)(void *,const char *,size_t),void *arg,const char * fmt,const struct xformat_arg_s * args,unsigned count)
+{
+	XCFG_FORMAT_STATIC struct param_s param;
 
-						param.dbl *= param.values.dvalue;
+	param.write = write;
+	param.arg = arg;
+	argsFromList(&param);
+	param.targ = args;
+	param.tcount = count;
+	param.tpos = 0;
 
-						param.values.lvalue = (unsigned LONG)param.dbl;
+	formatNoList(&param,fmt,0);
 
-						param.out = param.buffer + sizeof(param.buffer) - 1;
-						param.radix = 10;
-						if (param.prec)
-						{
-							ulong2a(&param);
-							*param.out -- = '.';
-							param.length ++;
-						}
-						param.flags |= FLAG_INTEGER | FLAG_BUFFER |
-									   FLAG_DECIMAL | FLAG_VALUE  | FLOAT_TYPE;
+	return param.count;
+}
 
-						param.prec = 0;
-						param.values.FLOAT_VALUE  = (unsigned FLOAT_LONG)param.iPart;
 
-#if XCFG_FORMAT_FLOAT_SPECIAL
-						}
-#endif
-						break;
-#endif
+/**
+ * Printf like format function executing a compiled format with the
+ * arguments in an array of tagged values, as xformat_args.
+ *
+ * @param prog	- Program returned by xformat_compile.
+ * @param write - Pointer to the function to output a run of chars.
+ * @param arg	- Argument for the output function.
+ * @param args	- Tagged arguments.
+ * @param count	- Number of arguments.
+ *
+ * @return The number of char emitted.
+ */
+unsigned xformat_compiled_args(const struct xformat_spec_s * prog,void (*write)(void *,const char *,size_t),void *arg,const struct xformat_arg_s * args,unsigned count)
+{
+	XCFG_FORMAT_STATIC struct param_s param;
 
-						/**
-						 * Boolean value
-						 */
-					case 'B':
-						if (va_arg(args,int) != 0)
-							param.out = (char*)ms_true;
-						else
-							param.out = (char*)ms_false;
+	param.write = write;
+	param.arg = arg;
+	argsFromList(&param);
+	param.targ = args;
+	param.tcount = count;
+	param.tpos = 0;
 
-						param.length = (int)xstrlen(param.out);
-						break;
+	formatNoList(&param,0,prog);
 
+	return param.count;
+}
+#endif
 
-				}
+#if XCFG_FORMAT_DEFER
+/**
+ * Initialize one ring of deferred records.
+ *
+ * @param ring	- Ring.
+ * @param buf	- Storage aligned as a double.
+ * @param size	- Size of the storage, must be a power of 2.
+ */
+void xformat_ring_init(struct xformat_ring_s * ring,void * buf,unsigned size)
+{
+	ring->buf = (char *)buf;
+	ring->size = size;
+	ring->head = ring->tail = 0;
+	ring->lost = 0;
+}
 
-				/*
-				 * Process integer number
-				 */
-				if (param.flags & FLAG_INTEGER)
-				{
-					if (param.prec == 0)
-						param.prec = 1;
 
-					if (!(param.flags & FLAG_VALUE))
-					{
-						switch (param.flags & FLAG_TYPE_MASK)
-						{
-							case FLAG_TYPE_SIZEOF:
-								param.values.lvalue = (unsigned LONG)va_arg(args,void *);
-								break;
-							case FLAG_TYPE_LONG:
-								if (param.flags & FLAG_DECIMAL)
-									param.values.lvalue = (LONG)va_arg(args,long);
-								else
-									param.values.lvalue = (unsigned LONG)va_arg(args,unsigned long);
-								break;
-								
-							case FLAG_TYPE_INT:
-								if (param.flags & FLAG_DECIMAL)
-									param.values.lvalue = (LONG)va_arg(args,int);
-								else
-									param.values.lvalue = (unsigned LONG)va_arg(args,unsigned int);
-								break;
-#if XCFG_FORMAT_LONGLONG
-							case FLAG_TYPE_LONGLONG:
-								param.values.llvalue = (LONGLONG)va_arg(args,long long);
-								break;
-#endif
-						}
+/**
+ * Capture the arguments of one format without converting them.
+ *
+ * The format is walked only to learn the type of the arguments that are
+ * copied, with the bytes of the strings, in one record tagged with the
+ * format pointer. The format string must be constant as it is used
+ * when the record is replayed.
+ *
+ * Only one thread can call xvformat_defer for the same ring.
+ *
+ * @param ring	- Ring of deferred records.
+ * @param fmt	- Format options for the list of parameters.
+ * @param args	- List parameters.
+ *
+ * @return The length of the record or 0 if the ring was full.
+ */
+unsigned xvformat_defer(struct xformat_ring_s * ring,const char * fmt,va_list args)
+{
+	unsigned head = ring->head;
+	unsigned free = ring->size - (head - DEFER_LOAD(&ring->tail));
+	unsigned pos = head & (ring->size - 1);
+	unsigned room = ring->size - pos;
+	struct defer_s * skip;
+	unsigned len;
 
-					}
+	len = deferTry(ring->buf + pos,room < free ? room : free,fmt,args);
 
-					if ((param.flags & FLAG_PREFIX) && param.values.lvalue == 0)
-					{
-						param.prefixlen = 0;
-					}
+	/* Retry from the start of the storage */
+	if (len == 0 && free > room)
+	{
+		if (room >= DEFER_HEADER)
+		{
+			skip = (struct defer_s *)(ring->buf + pos);
+			skip->fmt = 0;
+			skip->len = room;
+		}
 
+		head += room;
+		DEFER_STORE(&ring->head,head);
+		len = deferTry(ring->buf,free - room,fmt,args);
+	}
 
-					/*
-					 * Manage signed integer
-					 */
-					if (param.flags & FLAG_DECIMAL)
-					{
-#if XCFG_FORMAT_LONGLONG
-						if ((param.flags & FLAG_TYPE_MASK) == FLAG_TYPE_LONGLONG)
-						{
-							if ((LONGLONG)param.values.llvalue < 0)
-							{
-								param.values.llvalue = ~param.values.llvalue + 1;
-								param.flags |= FLAG_MINUS;
-							}
-						}
-						else 
-						{
-#endif
-							if ((LONG)param.values.lvalue < 0)
-							{
-								param.values.lvalue = ~param.values.lvalue + 1;
-								param.flags |= FLAG_MINUS;
+	if (len == 0)
+	{
+		ring->lost++;
+		return 0;
+	}
 
-							}
-#if XCFG_FORMAT_LONGLONG
-						}
-#endif
-						if (!(param.flags & FLAG_MINUS)  && (param.flags & FLAG_BLANK))
-						{
-							param.prefix[0] = ' ';
-							param.prefixlen = 1;
-						}
-					}
+	DEFER_STORE(&ring->head,head + len);
 
-					if ((param.flags & FLAG_BUFFER) == 0)
-					{
-						param.out = param.buffer + sizeof(param.buffer) - 1;
-					}
+	return len;
+}
 
 
-#if XCFG_FORMAT_LONGLONG
-					if ((param.flags & FLAG_TYPE_MASK) == FLAG_TYPE_LONGLONG)
-						ullong2a(&param);
-					else
-						ulong2a(&param);
-#else
+/**
+ * Capture the arguments of one format without converting them.
+ *
+ * @param ring	- Ring of deferred records.
+ * @param fmt	- Format options for the list of parameters.
+ * @param ...	- Arguments
+ *
+ * @return The length of the record or 0 if the ring was full.
+ *
+ * @see xvformat_defer
+ */
+unsigned xformat_defer(struct xformat_ring_s * ring,const char * fmt,...)
+{
+	va_list list;
+	unsigned len;
 
-					ulong2a(&param);
-#endif
-					param.out++;
+	va_start(list,fmt);
+	len = xvformat_defer(ring,fmt,list);
+	va_end(list);
 
-					/*
-					 * Check if a sign is required
-					 */
-					if (param.flags & (FLAG_MINUS|FLAG_PLUS))
-					{
-						c = param.flags & FLAG_MINUS ? '-' : '+';
+	(void)list;
 
-						if (param.pad == '0')
-						{
-							param.prefixlen = 1;
-							param.prefix[0] = c;
-						}
-						else
-						{
-							*--param.out = c;
-							param.length++;
-						}
-					}
+	return len;
+}
 
 
-				}
-				else
-				{
-					if (param.width && param.length > param.width)
-					{
-						param.length = param.width;
-					}
+/**
+ * Convert all the deferred records of one ring, the space of each
+ * record is released as soon as it is converted.
+ *
+ * The ring can be replayed by one thread at time, concurrently with the
+ * producer, or later from a copy of the storage. The records hold the
+ * pointers of the formats, valid only in the process that wrote them :
+ * with XCFG_FORMAT_DEFER_FMT the formats are copied in the records and
+ * a dump of the storage can be replayed by another process.
+ *
+ * @param ring	- Ring of deferred records.
+ * @param write - Pointer to the function to output a run of chars.
+ * @param arg	- Argument for the output function.
+ *
+ * @return The number of records converted.
+ */
+unsigned xformat_replay(struct xformat_ring_s * ring,void (*write)(void *,const char *,size_t),void *arg)
+{
+	XCFG_FORMAT_STATIC struct param_s param;
+	const struct defer_s * rec;
+	const char * fmt;
+	unsigned head = DEFER_LOAD(&ring->head);
+	unsigned tail = ring->tail;
+	unsigned pos,room;
+	unsigned count = 0;
 
-				}
+	param.write = write;
+	param.arg = arg;
+	argsFromList(&param);
 
-				/*
-				 * Now width contain the size of the pad
-				 */
-				param.width -= (param.length + param.prefixlen);
+	while (tail != head)
+	{
+		pos = tail & (ring->size - 1);
+		room = ring->size - pos;
 
-				param.count += outBuffer(outchar,arg,param.prefix,param.prefixlen,param.flags & FLAG_UPPER);
-				if (!(param.flags & FLAG_LEFT))
-					param.count += outChars(outchar,arg,param.pad,param.width);
-				param.count += outBuffer(outchar,arg,param.out,param.length,param.flags & FLAG_UPPER);
-				if (param.flags & FLAG_LEFT)
-					param.count += outChars(outchar,arg,param.pad,param.width);
-				
+		if (room < DEFER_HEADER)
+		{
+			tail += room;
 		}
-	}
-
-#if XCFG_FORMAT_VA_COPY
-	va_end(args);
+		else
+		{
+			rec = (const struct defer_s *)(ring->buf + pos);
+			if (rec->fmt != 0)
+			{
+				param.rec = ring->buf + pos;
+				param.recpos = DEFER_HEADER;
+#if XCFG_FORMAT_DEFER_FMT
+				fmt = param.rec + DEFER_HEADER;
+				param.recpos += xstrlen(fmt) + 1;
+#else
+				fmt = rec->fmt;
 #endif
+				formatNoList(&param,fmt,0);
+				count++;
+			}
+			tail += rec->len;
+		}
 
-	return param.count;
+		DEFER_STORE(&ring->tail,tail);
+	}
+
+	return count;
 }
+#endif
 
 /*lint -restore */
 
@@ -18,6 +18,7 @@
 #ifndef XFORMATC_H
 #define XFORMATC_H
 #include <stdarg.h>
+#include <stddef.h>
 #ifdef  __cplusplus
 extern "C" {
 #endif
@@ -43,9 +44,37 @@ extern "C" {
 #endif
 
 
+/**
+ * Define XCFG_FORMAT_TLS to 1 to keep the internal parameters of the
+ * functions without an explicit context in thread local storage, one
+ * copy for each thread reused by all the calls of the thread.
+ */
+#ifndef XCFG_FORMAT_TLS
+#define XCFG_FORMAT_TLS	0
+#endif
+
+#if XCFG_FORMAT_TLS
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L && !defined(__STDC_NO_THREADS__)
+#define XCFG_FORMAT_THREAD	_Thread_local
+#elif defined(_MSC_VER)
+#define XCFG_FORMAT_THREAD	__declspec(thread)
+#elif defined(__GNUC__)
+#define XCFG_FORMAT_THREAD	__thread
+#else
+#error "XCFG_FORMAT_TLS require thread local storage"
+#endif
+
+#ifndef XCFG_FORMAT_STATIC
+#define XCFG_FORMAT_STATIC	static XCFG_FORMAT_THREAD
+#endif
+#endif
+
+
 /**
  * Define internal parameters as volatile for 8 bit cpu define
- * XCFG_FORMAT_STATIC=static to reduce stack usage.
+ * XCFG_FORMAT_STATIC=static to reduce stack usage. Static parameters
+ * are shared by all the callers, use one xformat_ctx_s for each thread
+ * or interrupt level or XCFG_FORMAT_TLS in multi thread application.
  */
 #ifndef XCFG_FORMAT_STATIC
 #define XCFG_FORMAT_STATIC
@@ -113,10 +142,534 @@ extern "C" {
 #endif
 
 
+/**
+ * Define to 1 to convert floating point numbers from the exact binary
+ * representation using only integer arithmetic, the output is correctly
+ * rounded at any precision and nan / infinite are always supported.
+ * Require long long support.
+ */
+#ifndef XCFG_FORMAT_FLOAT_EXACT
+#define XCFG_FORMAT_FLOAT_EXACT	XCFG_FORMAT_LONGLONG
+#endif
+
+
+/**
+ * Define to 1 to print %e and %g without precision with the shortest
+ * digits that read back as the same number instead of 6 digits.
+ * Require XCFG_FORMAT_FLOAT_EXACT.
+ */
+#ifndef XCFG_FORMAT_FLOAT_SHORTEST
+#define XCFG_FORMAT_FLOAT_SHORTEST	0
+#endif
+
+#if XCFG_FORMAT_FLOAT_SHORTEST && !XCFG_FORMAT_FLOAT_EXACT
+#error "XCFG_FORMAT_FLOAT_SHORTEST require XCFG_FORMAT_FLOAT_EXACT"
+#endif
+
+
+/**
+ * Define XCFG_FORMAT_CACHE to the number of entries of the cache of the
+ * compiled format strings, 0 disable the cache. The cache is keyed by the
+ * format pointer, the length and a hash of the whole format, so a buffer
+ * reused for a different format is compiled again. Each entry hold up to
+ * XCFG_FORMAT_CACHE_SPECS specifiers, format strings with more
+ * specifiers are always parsed. The hits and the misses are read by
+ * xformat_cache_stats.
+ */
+#ifndef XCFG_FORMAT_CACHE
+#define XCFG_FORMAT_CACHE	0
+#endif
+
+#ifndef XCFG_FORMAT_CACHE_SPECS
+#define XCFG_FORMAT_CACHE_SPECS	8
+#endif
+
+#if XCFG_FORMAT_CACHE && !defined(__GNUC__)
+#error "XCFG_FORMAT_CACHE require the gcc atomic builtins"
+#endif
+
+
+/**
+ * Define XCFG_FORMAT_DEFER to 1 to enable the deferred format : the
+ * arguments are copied in a binary record by xformat_defer and converted
+ * later by xformat_replay. The records hold the format pointer and can
+ * be replayed only by the same process.
+ *
+ * Define XCFG_FORMAT_DEFER_FMT to 1 to copy also the format in each
+ * record, the records can be replayed by another process from a dump
+ * of the ring.
+ */
+#ifndef XCFG_FORMAT_DEFER
+#define XCFG_FORMAT_DEFER	0
+#endif
+
+#ifndef XCFG_FORMAT_DEFER_FMT
+#define XCFG_FORMAT_DEFER_FMT	0
+#endif
+
+
+/**
+ * Define XCFG_FORMAT_BATCH to 1 to enable xformat_batch : one format
+ * applied to many rows of arguments taken from arrays, one array for
+ * each argument. Format strings with more than XCFG_FORMAT_BATCH_SPECS
+ * specifiers are parsed again for each row.
+ */
+#ifndef XCFG_FORMAT_BATCH
+#define XCFG_FORMAT_BATCH	0
+#endif
+
+#ifndef XCFG_FORMAT_BATCH_SPECS
+#define XCFG_FORMAT_BATCH_SPECS	16
+#endif
+
+
+/**
+ * Literal text is scanned for the next % using :
+ *
+ * 0 - One char at time, for 8 and 16 bit cpu.
+ * 1 - One word at time.
+ * 2 - SSE2 16 bytes at time, fall back to 1 when not available.
+ */
+#ifndef XCFG_FORMAT_SCAN
+#if defined(__SDCC) || defined(__HCS08__) || defined(__HC08__) || defined(__AVR__) || defined(__MSP430__)
+#define XCFG_FORMAT_SCAN	0
+#elif defined(__SSE2__) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define XCFG_FORMAT_SCAN	2
+#else
+#define XCFG_FORMAT_SCAN	1
+#endif
+#endif
+
+
+/**
+ * Define XCFG_FORMAT_ARGS to 1 to enable xformat_args : the arguments
+ * are read from an array of tagged values, the tag and not the size
+ * modifier select the type of each argument. Used by xformatc.hpp to
+ * pass the arguments without va_arg, enabled by default except on the
+ * 8 and 16 bit cpu.
+ */
+#ifndef XCFG_FORMAT_ARGS
+#if defined(__SDCC) || defined(__HCS08__) || defined(__HC08__) || defined(__AVR__) || defined(__MSP430__)
+#define XCFG_FORMAT_ARGS	0
+#else
+#define XCFG_FORMAT_ARGS	1
+#endif
+#endif
+
+
+/**
+ * Define XCFG_FORMAT_STATS to 1 to count calls, chars, conversions and
+ * other events read by xformat_stats. The counters are kept in
+ * XCFG_FORMAT_STATS_SLOTS slots, with XCFG_FORMAT_TLS each thread use
+ * always the same slot and the counters are exact if the threads are
+ * not more than the slots.
+ */
+#ifndef XCFG_FORMAT_STATS
+#define XCFG_FORMAT_STATS		0
+#endif
+
+#ifndef XCFG_FORMAT_STATS_SLOTS
+#if XCFG_FORMAT_TLS
+#define XCFG_FORMAT_STATS_SLOTS	64
+#else
+#define XCFG_FORMAT_STATS_SLOTS	1
+#endif
+#endif
+
+
+/**
+ * Define XCFG_FORMAT_IOV to 1 to enable xformat_iov : the output is a
+ * list of runs ready for writev, literal text, strings and padding of
+ * at least XCFG_FORMAT_IOV_MIN chars are referenced in place and the
+ * other chars are copied in a small arena.
+ */
+#ifndef XCFG_FORMAT_IOV
+#define XCFG_FORMAT_IOV		0
+#endif
+
+#ifndef XCFG_FORMAT_IOV_MIN
+#define XCFG_FORMAT_IOV_MIN	32
+#endif
+
+
+/**
+ * Define XCFG_FORMAT_ARENA to 1 to enable xaformat : each string is
+ * formatted in a bump arena supplied by the caller, grown by chunks of
+ * at least XCFG_FORMAT_ARENA_CHUNK bytes only when it is full and
+ * released all at once by xformat_arena_reset.
+ */
+#ifndef XCFG_FORMAT_ARENA
+#define XCFG_FORMAT_ARENA		0
+#endif
+
+#ifndef XCFG_FORMAT_ARENA_CHUNK
+#define XCFG_FORMAT_ARENA_CHUNK	4096
+#endif
+
+
+/**
+ * Hex, binary and pointer digits are converted :
+ *
+ * 0 - One digit at time.
+ * 1 - Eight digits at time with 64 bit integer arithmetic.
+ * 2 - SSSE3 16 hex digits at time, fall back to 1 when not available.
+ */
+#ifndef XCFG_FORMAT_SIMD
+#if !XCFG_FORMAT_LONGLONG || XCFG_FORMAT_SCAN == 0
+#define XCFG_FORMAT_SIMD	0
+#elif defined(__SSSE3__) || defined(__AVX__)
+#define XCFG_FORMAT_SIMD	2
+#else
+#define XCFG_FORMAT_SIMD	1
+#endif
+#endif
+
+#if XCFG_FORMAT_SIMD && !XCFG_FORMAT_LONGLONG
+#error "XCFG_FORMAT_SIMD require XCFG_FORMAT_LONGLONG"
+#endif
+
+
+/**
+ * One step of a compiled format : an optional conversion followed by
+ * a literal text. The fields are private to xformatc.c and to the
+ * programs built at compile time by xformatc.hpp, the structure is
+ * public only to let the caller provide the storage.
+ */
+struct xformat_spec_s
+{
+	/** Literal text after the conversion, null at the end of the program */
+	const char *	literal;
+
+	/** Length of the literal text */
+	unsigned		litlen;
+
+	/** Decoded flags */
+	unsigned		flags;
+
+	/** Field width and precision */
+	int				width;
+	int				prec;
+
+	/** Conversion char, 0 if the step is only literal text */
+	char			type;
+
+	/** Radix for integer conversion */
+	unsigned char	radix;
+
+	/** Char used for padding */
+	char			pad;
+
+	/** Prefix of the field */
+	char			prefixlen;
+	char			prefix[2];
+};
+
+/**
+ * Flags of struct xformat_spec_s decoded by the parser
+ */
+#define XFORMAT_FLAG_TYPE_INT		0x0000	/* Argument is integer					*/
+#define XFORMAT_FLAG_TYPE_LONG		0x0001	/* Argument is long						*/
+#define XFORMAT_FLAG_TYPE_SIZEOF	0x0002	/* Argument is size_t					*/
+#define XFORMAT_FLAG_TYPE_LONGLONG	0x0003	/* Argument is long long				*/
+#define	XFORMAT_FLAG_TYPE_MASK		0x0003	/* Mask for field type					*/
+#define XFORMAT_FLAG_PREC			0x0004	/* Precision set						*/
+#define XFORMAT_FLAG_LEFT			0x0008	/* Left alignment						*/
+#define	XFORMAT_FLAG_BLANK			0x0010	/* Blank before positive integer number */
+#define	XFORMAT_FLAG_PREFIX			0x0020	/* Prefix required						*/
+#define XFORMAT_FLAG_PLUS			0x0040	/* Force a + before positive number		*/
+#define	XFORMAT_FLAG_UPPER			0x0080	/* Output in upper case letter			*/
+#define XFORMAT_FLAG_DECIMAL		0x0100	/* Decimal field						*/
+#define XFORMAT_FLAG_INTEGER		0x0200	/* Integer field						*/
+#define XFORMAT_FLAG_POINTER		0x2000	/* Pointer with fixed number of digits	*/
+
+/**
+ * Width or precision of a specifier taken from the arguments
+ */
+#define XFORMAT_SPEC_ARG			(-1)
+
+/**
+ * Next state and char class of the format machine for the chars from
+ * ' ' to 'z', the low nibble is the class of the char and the high
+ * nibble of the entry (class << 3) + state is the next state. Generated
+ * by xformattable.c.
+ */
+#define XFORMAT_STATES \
+	0x06,0x00,0x00,0x06,0x00,0x01,0x00,0x00, \
+	0x10,0x00,0x03,0x06,0x00,0x06,0x02,0x10, \
+	0x04,0x45,0x45,0x45,0x45,0x05,0x05,0x05, \
+	0x05,0x35,0x30,0x00,0x50,0x60,0x00,0x00, \
+	0x00,0x20,0x28,0x38,0x50,0x58,0x00,0x08, \
+	0x00,0x30,0x30,0x30,0x50,0x50,0x00,0x00, \
+	0x08,0x20,0x20,0x28,0x20,0x20,0x28,0x00, \
+	0x08,0x60,0x60,0x60,0x60,0x60,0x60,0x00, \
+	0x00,0x70,0x78,0x78,0x78,0x78,0x78,0x08, \
+	0x07,0x08,0x00,0x00,0x07,0x00,0x00,0x08, \
+	0x08,0x00,0x00,0x08,0x00,0x08,0x08,0x00, \
+	0x08,0x00,0x07
+
+
+/**
+ * Formatting context : storage for the parser state and the scratch
+ * buffer of the conversions reused by all the calls using the context.
+ * The content is private to xformatc.c and need no initialization, one
+ * context must not be used at the same time by two threads or by one
+ * function and an interrupt.
+ */
+#ifndef XCFG_FORMAT_CTX_SIZE
+#define XCFG_FORMAT_CTX_SIZE	(128 + (12 + 2 * (XCFG_FORMAT_DEFER != 0) + 3 * (XCFG_FORMAT_BATCH != 0) + \
+								2 * (XCFG_FORMAT_ARGS != 0) + (XCFG_FORMAT_STATS != 0)) * sizeof(void *))
+#endif
+
+struct xformat_ctx_s
+{
+	union
+	{
+		void *	p;
+		double	d;
+		long	l;
+		char	storage[XCFG_FORMAT_CTX_SIZE];
+	} u;
+};
+
+
 unsigned xformat(void (*outchar)(void *arg,char),void *arg,const char * fmt,...);
 
 unsigned xvformat(void (*outchar)(void *arg,char),void *arg,const char * fmt,va_list args);
 
+unsigned xformat_write(void (*write)(void *arg,const char *p,size_t n),void *arg,const char * fmt,...);
+
+unsigned xvformat_write(void (*write)(void *arg,const char *p,size_t n),void *arg,const char * fmt,va_list args);
+
+unsigned xsnformat(char *buf,size_t size,const char * fmt,...);
+
+unsigned xvsnformat(char *buf,size_t size,const char * fmt,va_list args);
+
+unsigned xformat_measure(const char * fmt,...);
+
+unsigned xvformat_measure(const char * fmt,va_list args);
+
+unsigned xformat_ctx(struct xformat_ctx_s * ctx,void (*write)(void *arg,const char *p,size_t n),void *arg,const char * fmt,...);
+
+unsigned xvformat_ctx(struct xformat_ctx_s * ctx,void (*write)(void *arg,const char *p,size_t n),void *arg,const char * fmt,va_list args);
+
+unsigned xsnformat_ctx(struct xformat_ctx_s * ctx,char *buf,size_t size,const char * fmt,...);
+
+unsigned xvsnformat_ctx(struct xformat_ctx_s * ctx,char *buf,size_t size,const char * fmt,va_list args);
+
+unsigned xformat_compile(const char * fmt,struct xformat_spec_s * prog,unsigned size);
+
+unsigned xformat_compiled(const struct xformat_spec_s * prog,void (*write)(void *arg,const char *p,size_t n),void *arg,...);
+
+unsigned xvformat_compiled(const struct xformat_spec_s * prog,void (*write)(void *arg,const char *p,size_t n),void *arg,va_list args);
+
+
+#if XCFG_FORMAT_CACHE
+void xformat_cache_stats(unsigned long * hits,unsigned long * misses);
+#endif
+
+
+#if XCFG_FORMAT_BATCH
+unsigned xformat_batch(const char * fmt,const void * const columns[],size_t rows,void (*write)(void *arg,const char *p,size_t n),void *arg);
+#endif
+
+
+#if XCFG_FORMAT_ARGS
+/**
+ * Type of one tagged argument
+ */
+#define XFORMAT_ARG_INT		0	/* Signed int or smaller in i			*/
+#define XFORMAT_ARG_UINT	1	/* Unsigned int or smaller in u			*/
+#define XFORMAT_ARG_LONG	2	/* Signed long in i						*/
+#define XFORMAT_ARG_ULONG	3	/* Unsigned long in u					*/
+#define XFORMAT_ARG_LLONG	4	/* Signed long long in i				*/
+#define XFORMAT_ARG_ULLONG	5	/* Unsigned long long in u				*/
+#define XFORMAT_ARG_DOUBLE	6	/* Floating point in d					*/
+#define XFORMAT_ARG_STRING	7	/* String in s							*/
+#define XFORMAT_ARG_POINTER	8	/* Pointer in p							*/
+
+/**
+ * One argument of xformat_args, all the integers are stored extended
+ * to the largest integer.
+ */
+struct xformat_arg_s
+{
+	union
+	{
+#if XCFG_FORMAT_LONGLONG
+		long long			i;
+		unsigned long long	u;
+#else
+		long				i;
+		unsigned long		u;
+#endif
+#if XCFG_FORMAT_FLOAT
+		double				d;
+#endif
+		const char *		s;
+		const void *		p;
+	} value;
+
+	unsigned char	type;
+};
+
+unsigned xformat_args(void (*write)(void *arg,const char *p,size_t n),void *arg,const char * fmt,const struct xformat_arg_s * args,unsigned count);
+
+unsigned xformat_compiled_args(const struct xformat_spec_s * prog,void (*write)(void *arg,const char *p,size_t n),void *arg,const struct xformat_arg_s * args,unsigned count);
+#endif
+
+
+#if XCFG_FORMAT_STATS
+/**
+ * Counters of xformat_stats, conversions are indexed by the conversion
+ * char using XFORMAT_STATS_INDEX.
+ */
+#define XFORMAT_STATS_CONV		('z' - 'A' + 1)
+#define XFORMAT_STATS_INDEX(c)	((c) - 'A')
+
+struct xformat_stats_s
+{
+	unsigned long	calls;			/* Format executed						*/
+	unsigned long	bytes;			/* Chars emitted including truncated	*/
+	unsigned long	writes;			/* Calls to the output function			*/
+	unsigned long	padding;		/* Chars added by the field width		*/
+	unsigned long	truncations;	/* Output truncated by the memory size	*/
+	unsigned long	cachehits;		/* Format found in the format cache		*/
+	unsigned long	cachemisses;	/* Format parsed with the format cache	*/
+	unsigned long	conv[XFORMAT_STATS_CONV];
+};
+
+void xformat_stats(struct xformat_stats_s * stats);
+
+void xformat_stats_reset(void);
+#endif
+
+
+#if XCFG_FORMAT_IOV
+/**
+ * One run of output, same layout of the POSIX struct iovec
+ */
+struct xformat_iovec_s
+{
+	void *	iov_base;
+	size_t	iov_len;
+};
+
+/**
+ * Destination of xformat_iov : the array of runs and the arena for the
+ * converted chars, both supplied by the caller. Many records can be
+ * added before writing the runs, the referenced strings must be valid
+ * until then. Set by xformat_iov_init.
+ */
+struct xformat_iov_s
+{
+	struct xformat_iovec_s *	iov;
+	unsigned		max;
+	unsigned		count;
+
+	char *			arena;
+	size_t			size;
+	size_t			used;
+
+	/** Set when the runs or the arena are full and the output truncated */
+	int				truncated;
+};
+
+void xformat_iov_init(struct xformat_iov_s * v,struct xformat_iovec_s * iov,unsigned max,char * arena,size_t size);
+
+unsigned xformat_iov(struct xformat_iov_s * v,const char * fmt,...);
+
+unsigned xvformat_iov(struct xformat_iov_s * v,const char * fmt,va_list args);
+#endif
+
+
+#if XCFG_FORMAT_ARENA
+/**
+ * One chunk added to an arena, the chars follow the header.
+ */
+struct xformat_chunk_s
+{
+	struct xformat_chunk_s *	next;
+	size_t			size;
+};
+
+/**
+ * Bump arena of xaformat. The first chunk is the buffer supplied to
+ * xformat_arena_init, the other chunks are obtained from alloc and kept
+ * after a reset to be used again. The fields are private to xformatc.c.
+ */
+struct xformat_arena_s
+{
+	/** Allocate (ptr null) or release (size 0) one chunk, can be null */
+	void *			(*alloc)(void *arg,void *ptr,size_t size);
+	void *			arg;
+
+	/** Buffer supplied by the caller */
+	char *			first;
+	size_t			firstsize;
+
+	/** All the chunks allocated and the last one in use */
+	struct xformat_chunk_s *	chunks;
+	struct xformat_chunk_s *	last;
+
+	/** Current chunk and start of the string being formatted */
+	char *			buf;
+	size_t			size;
+	size_t			used;
+	size_t			start;
+
+	/** Set when one chunk can not be allocated */
+	int				failed;
+};
+
+/**
+ * String formatted by xaformat, nul terminated and valid until the
+ * arena is reset. str is null if the arena can not be grown.
+ */
+struct xformat_str_s
+{
+	char *			str;
+	size_t			len;
+};
+
+void xformat_arena_init(struct xformat_arena_s * a,char * buf,size_t size,void * (*alloc)(void *arg,void *ptr,size_t size),void *arg);
+
+void xformat_arena_reset(struct xformat_arena_s * a);
+
+void xformat_arena_free(struct xformat_arena_s * a);
+
+struct xformat_str_s xaformat(struct xformat_arena_s * a,const char * fmt,...);
+
+struct xformat_str_s xvaformat(struct xformat_arena_s * a,const char * fmt,va_list args);
+#endif
+
+
+#if XCFG_FORMAT_DEFER
+/**
+ * Ring of deferred records in caller storage for one producer and one
+ * consumer. The fields are private to xformatc.c, use xformat_ring_init.
+ */
+struct xformat_ring_s
+{
+	/** Storage aligned as a double, size is a power of 2 */
+	char *			buf;
+	unsigned		size;
+
+	/** Free running write and read position */
+	unsigned		head;
+	unsigned		tail;
+
+	/** Number of records lost because the ring was full */
+	unsigned long	lost;
+};
+
+void xformat_ring_init(struct xformat_ring_s * ring,void * buf,unsigned size);
+
+unsigned xformat_defer(struct xformat_ring_s * ring,const char * fmt,...);
+
+unsigned xvformat_defer(struct xformat_ring_s * ring,const char * fmt,va_list args);
+
+unsigned xformat_replay(struct xformat_ring_s * ring,void (*write)(void *arg,const char *p,size_t n),void *arg);
+#endif
 
 
 #ifdef  __cplusplus
@@ -0,0 +1,831 @@
+/**
+ * @file        xformatc.hpp
+ *
+ * @brief       C++17 interface with format strings checked at compile time.
+ *
+ * The format string is carried in one type by XFORMAT_FMT and compiled
+ * at compile time by a constexpr port of parseSpec walking the same
+ * formatStates table (XFORMAT_STATES), the program is a constant and the
+ * number and the type of the arguments are checked by static_assert.
+ * Each argument is converted to the type the specifier read, so a
+ * mismatch is a compile error and not undefined behavior. With
+ * XCFG_FORMAT_ARGS (default except on 8 and 16 bit cpu) the arguments
+ * are passed to xformat_compiled_args as an array of tagged values typed
+ * at compile time and va_arg is not used, with XCFG_FORMAT_ARGS=0 they
+ * are passed to xformat_compiled.
+ *
+ *   xformatc::snformat(buf,sizeof(buf),XFORMAT_FMT("%d %s"),n,name);
+ *
+ * Format strings that the C engine print as literal text, as %y or %5%,
+ * are rejected, %% is accepted.
+ *
+ * With XCFG_FORMAT_ARGS the format string can be known only at run time,
+ * xformatc::xformat pack the arguments by C++ type in a small array of
+ * tagged values and the C engine read the array in place of a va_list.
+ *
+ * @author      Mario Viara
+ *
+ * @copyright   Copyright Mario Viara 2014  - License Open Source (LGPL)
+ * This is a free software and is opened for education, research and commercial
+ * developments under license policy of following terms:
+ * - This is a free software and there is NO WARRANTY.
+ * - No restriction on use. You can use, modify and redistribute it for personal,
+ *   non-profit or commercial product UNDER YOUR RESPONSIBILITY.
+ * - Redistributions of source code must retain the above copyright notice.
+ *
+ * To contact the author send an email to mario_at_viara.eu*
+ */
+#ifndef XFORMATC_HPP
+#define XFORMATC_HPP
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include "xformatc.h"
+
+#if __cplusplus < 201703L && !(defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+#error "xformatc.hpp require C++17"
+#endif
+
+
+/**
+ * Format string for the functions of xformatc, the string literal is
+ * returned by the static function str of one unique type.
+ */
+#define XFORMAT_FMT(s) \
+	([] { struct xformat_fmt_s { static constexpr const char * str() { return s; } }; return xformat_fmt_s(); }())
+
+
+namespace xformatc
+{
+
+namespace detail
+{
+
+/**
+ * Type of one argument as read by the C engine
+ */
+enum arg_e : unsigned char
+{
+	arg_int,		/* %d %i %* 				*/
+	arg_uint,		/* %u %x %X %o %b			*/
+	arg_long,		/* %ld						*/
+	arg_ulong,		/* %lu %lx ...				*/
+	arg_llong,		/* %lld						*/
+	arg_ullong,		/* %llu %llx ...			*/
+	arg_size,		/* %zd %zx ... length of %v	*/
+	arg_double,		/* %f %e %E %g %G			*/
+	arg_string,		/* %s %S and pointer of %v	*/
+	arg_pointer,	/* %p %P					*/
+	arg_char,		/* %c %C					*/
+	arg_bool		/* %B						*/
+};
+
+
+/**
+ * States of the format machine, same values of the enum in xformatc.c
+ */
+enum
+{
+	st_normal, st_percent, st_flag, st_width, st_dot, st_precis, st_size, st_type
+};
+
+
+/**
+ * Next state and char class of the format machine, the same table of
+ * formatStates in xformatc.c generated by xformattable.c
+ */
+constexpr unsigned char formatStates[] =
+{
+	XFORMAT_STATES
+};
+
+static_assert(sizeof(formatStates) == 'z' - ' ' + 1,"xformatc: format machine table");
+
+
+/**
+ * Number of % in the format, each one can start a step of the program
+ * and read up to 4 arguments.
+ */
+constexpr std::size_t percents(const char * s)
+{
+	std::size_t n = 0;
+
+	for ( ; *s ; s++)
+	{
+		if (*s == '%')
+			n++;
+	}
+
+	return n;
+}
+
+
+/**
+ * Program of one format string built at compile time, same steps of
+ * xformat_compile. valid is false if one specifier other than %% is
+ * not a conversion or the format terminate inside one specifier.
+ */
+template <std::size_t N>
+struct program_s
+{
+	struct xformat_spec_s	spec[N];
+	std::size_t				count;
+	bool					valid;
+};
+
+
+constexpr const char * scanLiteral(const char * s)
+{
+	while (*s && *s != '%')
+	{
+		s++;
+	}
+
+	return s;
+}
+
+
+/**
+ * Decode one conversion specifier and the literal text after it, a
+ * constexpr port of parseSpec in xformatc.c.
+ */
+constexpr const char * parseSpec(const char * fmt,struct xformat_spec_s & spec,bool & valid)
+{
+	int state = st_normal;
+	int prev = st_normal;
+	int i = 0;
+	char c = 0;
+
+	spec.type = 0;
+
+	while ((c = *fmt++) != 0)
+	{
+		if (c < ' ' || c > 'z')
+			i = 0;
+		else
+			i = formatStates[c - ' '] & 0x0F;
+
+		prev = state;
+		state = formatStates[(i << 3) + state] >> 4;
+
+		switch (state)
+		{
+			default:
+			case st_normal:
+				/* Only %% is accepted as not conversion */
+				if (!(prev == st_percent && c == '%'))
+					valid = false;
+				spec.type = 0;
+				spec.literal = fmt - 1;
+				fmt = scanLiteral(fmt);
+				spec.litlen = static_cast<unsigned>(fmt - spec.literal);
+				return fmt;
+
+			case st_percent:
+				spec.flags = 0;
+				spec.width = spec.prec = 0;
+				spec.prefixlen = 0;
+				spec.radix = 10;
+				spec.pad = ' ';
+				break;
+
+			case st_width:
+				if (c == '*')
+					spec.width = XFORMAT_SPEC_ARG;
+				else if (spec.width != XFORMAT_SPEC_ARG)
+					spec.width = spec.width * 10 + (c - '0');
+				break;
+
+			case st_dot:
+				spec.flags |= XFORMAT_FLAG_PREC;
+				break;
+
+			case st_precis:
+				spec.flags |= XFORMAT_FLAG_PREC;
+				if (c == '*')
+					spec.prec = XFORMAT_SPEC_ARG;
+				else if (spec.prec != XFORMAT_SPEC_ARG)
+					spec.prec = spec.prec * 10 + (c - '0');
+				break;
+
+			case st_size:
+				if (c == 'z')
+				{
+					spec.flags &= ~XFORMAT_FLAG_TYPE_MASK;
+					spec.flags |= XFORMAT_FLAG_TYPE_SIZEOF;
+				}
+#if XCFG_FORMAT_LONG
+				else if (c == 'l')
+				{
+#if XCFG_FORMAT_LONGLONG
+					unsigned size = (spec.flags & XFORMAT_FLAG_TYPE_MASK) == XFORMAT_FLAG_TYPE_LONG ? XFORMAT_FLAG_TYPE_LONGLONG : XFORMAT_FLAG_TYPE_LONG;
+#else
+					unsigned size = XFORMAT_FLAG_TYPE_LONG;
+#endif
+					spec.flags &= ~XFORMAT_FLAG_TYPE_MASK;
+					spec.flags |= size;
+				}
+#endif
+				break;
+
+			case st_flag:
+				switch (c)
+				{
+					case '-':
+						spec.flags |= XFORMAT_FLAG_LEFT;
+						break;
+					case '0':
+						spec.pad = '0';
+						break;
+					case ' ':
+						spec.flags |= XFORMAT_FLAG_BLANK;
+						break;
+					case '#':
+						spec.flags |= XFORMAT_FLAG_PREFIX;
+						break;
+					case '+':
+						spec.flags |= XFORMAT_FLAG_PLUS;
+						break;
+					default:
+						break;
+				}
+				break;
+
+			case st_type:
+				switch (c)
+				{
+					case 'P':
+						spec.flags |= XFORMAT_FLAG_UPPER;
+						[[fallthrough]];
+					case 'p':
+						spec.flags &= ~XFORMAT_FLAG_TYPE_MASK;
+						spec.flags |= XFORMAT_FLAG_INTEGER | XFORMAT_FLAG_TYPE_SIZEOF | XFORMAT_FLAG_POINTER;
+						spec.radix = 16;
+						spec.prefix[0] = '-';
+						spec.prefix[1] = '>';
+						spec.prefixlen = 2;
+						break;
+
+					case 'b':
+						spec.flags |= XFORMAT_FLAG_INTEGER;
+						spec.radix = 2;
+						if (spec.flags & XFORMAT_FLAG_PREFIX)
+						{
+							spec.prefix[0] = '0';
+							spec.prefix[1] = 'b';
+							spec.prefixlen = 2;
+						}
+						break;
+
+					case 'o':
+						spec.flags |= XFORMAT_FLAG_INTEGER;
+						spec.radix = 8;
+						if (spec.flags & XFORMAT_FLAG_PREFIX)
+						{
+							spec.prefix[0] = '0';
+							spec.prefixlen = 1;
+						}
+						break;
+
+					case 'X':
+						spec.flags |= XFORMAT_FLAG_UPPER;
+						[[fallthrough]];
+					case 'x':
+						spec.flags |= XFORMAT_FLAG_INTEGER;
+						spec.radix = 16;
+						if (spec.flags & XFORMAT_FLAG_PREFIX)
+						{
+							spec.prefix[0] = '0';
+							spec.prefix[1] = spec.flags & XFORMAT_FLAG_UPPER ? 'X' : 'x';
+							spec.prefixlen = 2;
+						}
+						break;
+
+					case 'd':
+					case 'i':
+						spec.flags |= XFORMAT_FLAG_DECIMAL;
+						[[fallthrough]];
+					case 'u':
+						spec.flags |= XFORMAT_FLAG_INTEGER;
+						break;
+
+					case 'S':
+					case 'C':
+					case 'V':
+						spec.flags |= XFORMAT_FLAG_UPPER;
+						break;
+
+#if XCFG_FORMAT_FLOAT
+					case 'E':
+					case 'G':
+						spec.flags |= XFORMAT_FLAG_UPPER;
+						[[fallthrough]];
+					case 'e':
+					case 'g':
+					case 'f':
+						if (!(spec.flags & XFORMAT_FLAG_PREC))
+							spec.prec = 6;
+						break;
+#endif
+
+					default:
+						break;
+				}
+
+				spec.type = c;
+				spec.literal = fmt;
+				fmt = scanLiteral(fmt);
+				spec.litlen = static_cast<unsigned>(fmt - spec.literal);
+				return fmt;
+		}
+	}
+
+	/* Format terminated inside one specifier */
+	valid = false;
+	spec.type = 0;
+	spec.literal = fmt - 1;
+	spec.litlen = 0;
+
+	return fmt - 1;
+}
+
+
+/**
+ * Decode all the specifiers of one format string, a constexpr port of
+ * compile in xformatc.c. N must be at least the number of % plus 2.
+ */
+template <std::size_t N>
+constexpr program_s<N> compile(const char * fmt)
+{
+	program_s<N> p {};
+	std::size_t n = 1;
+
+	p.valid = true;
+	p.spec[0].literal = fmt;
+	fmt = scanLiteral(fmt);
+	p.spec[0].litlen = static_cast<unsigned>(fmt - p.spec[0].literal);
+
+	for ( ; *fmt ; n++)
+	{
+		fmt = parseSpec(fmt,p.spec[n],p.valid);
+	}
+
+	p.spec[n].literal = nullptr;
+	p.count = n + 1;
+
+	return p;
+}
+
+
+/**
+ * Program of one format string, a constant in read only memory.
+ */
+template <class Fmt>
+inline constexpr auto programOf = compile<percents(Fmt::str()) + 2>(Fmt::str());
+
+
+/**
+ * Arguments read by one format string
+ */
+template <std::size_t N>
+struct args_s
+{
+	arg_e		type[N + 1];
+	std::size_t	count;
+	bool		valid;
+};
+
+
+/**
+ * Type of the argument read by one conversion.
+ *
+ * @param c		- Conversion char.
+ * @param size	- Size flags of the specifier.
+ * @param type	- Type of the argument.
+ *
+ * @return false if the conversion is not supported.
+ */
+constexpr bool convType(char c,unsigned size,arg_e & type)
+{
+	switch (c)
+	{
+		case 'd':
+		case 'i':
+			type = size == XFORMAT_FLAG_TYPE_SIZEOF ? arg_size : size == XFORMAT_FLAG_TYPE_LONGLONG ? arg_llong : size == XFORMAT_FLAG_TYPE_LONG ? arg_long : arg_int;
+			return true;
+		case 'u':
+		case 'x':
+		case 'X':
+		case 'o':
+		case 'b':
+			type = size == XFORMAT_FLAG_TYPE_SIZEOF ? arg_size : size == XFORMAT_FLAG_TYPE_LONGLONG ? arg_ullong : size == XFORMAT_FLAG_TYPE_LONG ? arg_ulong : arg_uint;
+			return true;
+		case 'c':
+		case 'C':
+			type = arg_char;
+			return true;
+		case 's':
+		case 'S':
+		case 'v':
+		case 'V':
+			type = arg_string;
+			return true;
+		case 'p':
+		case 'P':
+			type = arg_pointer;
+			return true;
+		case 'B':
+			type = arg_bool;
+			return true;
+#if XCFG_FORMAT_FLOAT
+		case 'f':
+		case 'e':
+		case 'E':
+		case 'g':
+		case 'G':
+			type = arg_double;
+			return true;
+#endif
+		default:
+			return false;
+	}
+}
+
+
+/**
+ * Arguments of one format string in the order the steps of its program
+ * read them.
+ */
+template <class Fmt>
+constexpr auto decode()
+{
+	constexpr auto & p = programOf<Fmt>;
+	args_s<4 * percents(Fmt::str())> a {};
+
+	a.valid = p.valid;
+
+	for (std::size_t n = 1 ; n < p.count ; n++)
+	{
+		const struct xformat_spec_s & spec = p.spec[n];
+
+		if (spec.type == 0)
+			continue;
+
+		if (spec.width == XFORMAT_SPEC_ARG)
+			a.type[a.count++] = arg_int;
+		if (spec.prec == XFORMAT_SPEC_ARG)
+			a.type[a.count++] = arg_int;
+		if (!convType(spec.type,spec.flags & XFORMAT_FLAG_TYPE_MASK,a.type[a.count++]))
+			a.valid = false;
+		/* The string view is followed by its length */
+		if (spec.type == 'v' || spec.type == 'V')
+			a.type[a.count++] = arg_size;
+	}
+
+	return a;
+}
+
+
+template <class T>
+constexpr bool isInteger = std::is_integral<T>::value && !std::is_same<T,bool>::value;
+
+/**
+ * Check if one argument can be passed for one type without loss.
+ */
+template <class T>
+constexpr bool accept(arg_e type)
+{
+	switch (type)
+	{
+		case arg_int:
+		case arg_uint:
+		case arg_char:
+			return isInteger<T> && sizeof(T) <= sizeof(int);
+		case arg_long:
+		case arg_ulong:
+			return isInteger<T> && sizeof(T) <= sizeof(long);
+		case arg_llong:
+		case arg_ullong:
+			return isInteger<T> && sizeof(T) <= sizeof(long long);
+		case arg_size:
+			return isInteger<T> && sizeof(T) <= sizeof(std::size_t);
+		case arg_double:
+			return std::is_floating_point<T>::value && sizeof(T) <= sizeof(double);
+		case arg_string:
+			return std::is_same<T,const char *>::value || std::is_same<T,char *>::value ||
+				std::is_same<T,std::nullptr_t>::value;
+		case arg_pointer:
+			return std::is_pointer<T>::value || std::is_same<T,std::nullptr_t>::value;
+		case arg_bool:
+			return std::is_same<T,bool>::value || isInteger<T>;
+	}
+
+	return false;
+}
+
+
+/**
+ * Convert one argument to the type read by the C engine
+ */
+template <arg_e Type> struct pass_s;
+
+template <> struct pass_s<arg_int>		{ template <class T> static int get(T v) { return static_cast<int>(v); } };
+template <> struct pass_s<arg_uint>		{ template <class T> static unsigned get(T v) { return static_cast<unsigned>(v); } };
+template <> struct pass_s<arg_long>		{ template <class T> static long get(T v) { return static_cast<long>(v); } };
+template <> struct pass_s<arg_ulong>	{ template <class T> static unsigned long get(T v) { return static_cast<unsigned long>(v); } };
+template <> struct pass_s<arg_llong>	{ template <class T> static long long get(T v) { return static_cast<long long>(v); } };
+template <> struct pass_s<arg_ullong>	{ template <class T> static unsigned long long get(T v) { return static_cast<unsigned long long>(v); } };
+template <> struct pass_s<arg_size>		{ template <class T> static std::size_t get(T v) { return static_cast<std::size_t>(v); } };
+template <> struct pass_s<arg_double>	{ template <class T> static double get(T v) { return static_cast<double>(v); } };
+template <> struct pass_s<arg_string>	{ template <class T> static const char * get(T v) { return v; } };
+template <> struct pass_s<arg_pointer>	{ template <class T> static const void * get(T v) { return (const void *)v; } };
+template <> struct pass_s<arg_char>		{ template <class T> static int get(T v) { return static_cast<int>(v); } };
+template <> struct pass_s<arg_bool>		{ template <class T> static int get(T v) { return v ? 1 : 0; } };
+
+
+template <class Fmt,class... Args,std::size_t... I>
+constexpr bool acceptAll(std::index_sequence<I...>)
+{
+	constexpr auto a = decode<Fmt>();
+
+	return (accept<std::decay_t<Args>>(a.type[I]) && ...);
+}
+
+
+#if XCFG_FORMAT_ARGS
+/**
+ * Tag of the tagged value for one type read by the C engine
+ */
+constexpr unsigned char tagOf(arg_e type)
+{
+	switch (type)
+	{
+		case arg_uint:
+			return XFORMAT_ARG_UINT;
+		case arg_long:
+			return XFORMAT_ARG_LONG;
+		case arg_ulong:
+			return XFORMAT_ARG_ULONG;
+		case arg_llong:
+			return XFORMAT_ARG_LLONG;
+		case arg_ullong:
+			return XFORMAT_ARG_ULLONG;
+		case arg_size:
+			return sizeof(std::size_t) <= sizeof(unsigned long) ? XFORMAT_ARG_ULONG : XFORMAT_ARG_ULLONG;
+#if XCFG_FORMAT_FLOAT
+		case arg_double:
+			return XFORMAT_ARG_DOUBLE;
+#endif
+		case arg_string:
+			return XFORMAT_ARG_STRING;
+		case arg_pointer:
+			return XFORMAT_ARG_POINTER;
+		default:
+			return XFORMAT_ARG_INT;
+	}
+}
+
+
+/**
+ * Pack one argument in a tagged value of the type the specifier read.
+ */
+template <arg_e Type,class T>
+inline struct xformat_arg_s typed(T v)
+{
+	struct xformat_arg_s a = {};
+	auto x = pass_s<Type>::get(v);
+
+	a.type = tagOf(Type);
+
+	if constexpr (Type == arg_string)
+		a.value.s = x;
+	else if constexpr (Type == arg_pointer)
+		a.value.p = x;
+#if XCFG_FORMAT_FLOAT
+	else if constexpr (Type == arg_double)
+		a.value.d = x;
+#endif
+	else if constexpr (std::is_signed<decltype(x)>::value)
+		a.value.i = x;
+	else
+		a.value.u = x;
+
+	return a;
+}
+#endif
+
+
+/**
+ * Execute the program of one format, with XCFG_FORMAT_ARGS the
+ * arguments are passed as an array of tagged values typed at compile
+ * time, else in the argument list of xformat_compiled.
+ */
+template <class Fmt,class... Args,std::size_t... I>
+unsigned call(void (*write)(void *,const char *,std::size_t),void * arg,std::index_sequence<I...>,const Args &... args)
+{
+	constexpr auto a = decode<Fmt>();
+
+#if XCFG_FORMAT_ARGS
+	const struct xformat_arg_s list[sizeof...(I) + 1] = { typed<a.type[I]>(args)... };
+
+	return xformat_compiled_args(programOf<Fmt>.spec,write,arg,list,sizeof...(I));
+#else
+	return xformat_compiled(programOf<Fmt>.spec,write,arg,pass_s<a.type[I]>::get(args)...);
+#endif
+}
+
+
+/**
+ * Destination of snformat, truncated as vsnprintf
+ */
+struct memory_s
+{
+	char *	buf;
+	char *	end;
+};
+
+inline void writeMemory(void * arg,const char * p,std::size_t n)
+{
+	memory_s * m = static_cast<memory_s *>(arg);
+
+	while (n-- > 0 && m->buf < m->end)
+	{
+		*m->buf++ = *p++;
+	}
+}
+
+
+#if XCFG_FORMAT_ARGS
+template <class T>
+constexpr bool alwaysFalse = false;
+
+/**
+ * Pack one argument in a tagged value, the tag is selected by the C++
+ * type so the size modifier of the specifier is not required.
+ */
+template <class T>
+inline struct xformat_arg_s tagged(T v)
+{
+	struct xformat_arg_s a = {};
+
+	if constexpr (std::is_enum<T>::value)
+		return tagged(static_cast<std::underlying_type_t<T>>(v));
+	else if constexpr (std::is_same<T,bool>::value)
+	{
+		a.type = XFORMAT_ARG_INT;
+		a.value.i = v ? 1 : 0;
+	}
+	else if constexpr (std::is_integral<T>::value)
+	{
+		static_assert(sizeof(T) <= sizeof(a.value.i),"xformatc: integer argument too large");
+
+		if constexpr (std::is_signed<T>::value)
+		{
+			a.type = sizeof(T) <= sizeof(int) ? XFORMAT_ARG_INT : sizeof(T) <= sizeof(long) ? XFORMAT_ARG_LONG : XFORMAT_ARG_LLONG;
+			a.value.i = v;
+		}
+		else
+		{
+			a.type = sizeof(T) <= sizeof(int) ? XFORMAT_ARG_UINT : sizeof(T) <= sizeof(long) ? XFORMAT_ARG_ULONG : XFORMAT_ARG_ULLONG;
+			a.value.u = v;
+		}
+	}
+	else if constexpr (std::is_floating_point<T>::value)
+	{
+#if XCFG_FORMAT_FLOAT
+		a.type = XFORMAT_ARG_DOUBLE;
+		a.value.d = static_cast<double>(v);
+#else
+		static_assert(alwaysFalse<T>,"xformatc: floating point not enabled");
+#endif
+	}
+	else if constexpr (std::is_same<T,const char *>::value || std::is_same<T,char *>::value)
+	{
+		a.type = XFORMAT_ARG_STRING;
+		a.value.s = v;
+	}
+	else if constexpr (std::is_pointer<T>::value || std::is_same<T,std::nullptr_t>::value)
+	{
+		a.type = XFORMAT_ARG_POINTER;
+		a.value.p = (const void *)v;
+	}
+	else
+		static_assert(alwaysFalse<T>,"xformatc: argument type not supported");
+
+	return a;
+}
+
+
+/**
+ * Output function calling one sink, inlined for each type of sink.
+ */
+template <class Sink>
+void sinkWrite(void * arg,const char * p,std::size_t n)
+{
+	(*static_cast<Sink *>(arg))(p,n);
+}
+#endif
+
+} /* namespace detail */
+
+
+/**
+ * Check at compile time if a format string accept a list of arguments.
+ */
+template <class Fmt,class... Args>
+constexpr bool valid()
+{
+	constexpr auto a = detail::decode<Fmt>();
+
+	if constexpr (!a.valid || a.count != sizeof...(Args))
+		return false;
+	else
+		return detail::acceptAll<Fmt,Args...>(std::index_sequence_for<Args...>());
+}
+
+
+/**
+ * Printf like format function using a function to emit runs of chars.
+ *
+ * @param write - Pointer to the function to output a run of chars.
+ * @param arg	- Argument for the output function.
+ * @param fmt	- Format string made by XFORMAT_FMT.
+ * @param args	- Arguments checked against the format.
+ *
+ * @return The number of char emitted.
+ */
+template <class Fmt,class... Args>
+unsigned format(void (*write)(void *,const char *,std::size_t),void * arg,Fmt fmt,const Args &... args)
+{
+	constexpr auto a = detail::decode<Fmt>();
+
+	static_assert(a.valid,"xformatc: invalid format string");
+	static_assert(!a.valid || a.count == sizeof...(Args),"xformatc: the number of arguments does not match the format");
+
+	(void)fmt;
+
+	if constexpr (a.valid && a.count == sizeof...(Args))
+	{
+		static_assert(detail::acceptAll<Fmt,Args...>(std::index_sequence_for<Args...>()),"xformatc: argument type does not match the format");
+
+		return detail::call<Fmt>(write,arg,std::index_sequence_for<Args...>(),args...);
+	}
+	else
+		return 0;
+}
+
+
+/**
+ * Printf like format function writing directly in memory.
+ *
+ * The output is truncated to size - 1 chars and always terminated
+ * by a nul char if size is not zero.
+ *
+ * @param buf	- Destination buffer.
+ * @param size	- Size of the destination buffer.
+ * @param fmt	- Format string made by XFORMAT_FMT.
+ * @param args	- Arguments checked against the format.
+ *
+ * @return The number of char that would be emitted without truncation.
+ */
+template <class Fmt,class... Args>
+unsigned snformat(char * buf,std::size_t size,Fmt fmt,const Args &... args)
+{
+	detail::memory_s m = { buf,size ? buf + size - 1 : buf };
+	unsigned count = format(detail::writeMemory,&m,fmt,args...);
+
+	if (size)
+		*m.buf = 0;
+
+	return count;
+}
+
+
+#if XCFG_FORMAT_ARGS
+/**
+ * Printf like format function with the format string not known at
+ * compile time, the arguments are packed by type in an array of tagged
+ * values read by xformat_args without a va_list.
+ *
+ *   xformatc::xformat([&](const char * p,std::size_t n) { out.append(p,n); },fmt,n,name);
+ *
+ * @param sink	- Callable invoked with (const char *,std::size_t).
+ * @param fmt	- Format string.
+ * @param args	- Arguments, integer, floating point, string or pointer.
+ *
+ * @return The number of char emitted.
+ */
+template <class Sink,class... Args>
+unsigned xformat(Sink && sink,const char * fmt,const Args &... args)
+{
+	using sink_t = std::remove_reference_t<Sink>;
+	const struct xformat_arg_s list[sizeof...(Args) + 1] = { detail::tagged<std::decay_t<const Args &>>(args)... };
+
+	return xformat_args(detail::sinkWrite<sink_t>,const_cast<void *>(static_cast<const void *>(std::addressof(sink))),fmt,list,sizeof...(Args));
+}
+#endif
+
+} /* namespace xformatc */
+
+#endif
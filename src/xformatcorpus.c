@@ -0,0 +1,287 @@
+/**
+ * @file        xformatcorpus.c
+ *
+ * @brief       Convert a corpus of formats and arguments in C for xformatreplay
+ *
+ * A variable argument list can not be built at run time, so each record
+ * of the corpus is converted in one function calling the format with
+ * its arguments and compiled with xformatreplay.c :
+ *
+ *   xformatcorpus corpus.txt > xformatreplay.inc
+ *
+ * One record for each line, empty lines and lines starting with # are
+ * ignored :
+ *
+ *   weight "format" type:value ...
+ *
+ * The weight is the relative frequency of the record in the traffic, a
+ * record of weight 0 is timed alone but not in the mix. The format is
+ * a C string literal and the types of the arguments are :
+ *
+ *   i int, u unsigned, l long, ul unsigned long, ll long long,
+ *   ull unsigned long long, z size_t, c char, d double,
+ *   s string as C literal or NULL, p pointer as integer value.
+ *
+ *
+ * @author      Mario Viara
+ *
+ * @version     1.00
+ *
+ * @copyright   Copyright Mario Viara 2014  - License Open Source (LGPL)
+ * This is a free software and is opened for education, research and commercial
+ * developments under license policy of following terms:
+ * - This is a free software and there is NO WARRANTY.
+ * - No restriction on use. You can use, modify and redistribute it for personal,
+ *   non-profit or commercial product UNDER YOUR RESPONSIBILITY.
+ * - Redistributions of source code must retain the above copyright notice.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+#define MAX_LINE		8192
+#define MAX_RECORDS		4096
+
+/**
+ * Type of one argument : name in the corpus, cast and suffix of the
+ * value in the generated code.
+ */
+struct type_s
+{
+	const char *	name;
+	const char *	cast;
+	const char *	suffix;
+};
+
+static const struct type_s types[] =
+{
+	{"i",	"(int)",					""},
+	{"u",	"(unsigned)",				"U"},
+	{"l",	"(long)",					"L"},
+	{"ul",	"(unsigned long)",			"UL"},
+	{"ll",	"(long long)",				"LL"},
+	{"ull",	"(unsigned long long)",		"ULL"},
+	{"z",	"(size_t)",					"ULL"},
+	{"c",	"(int)",					""},
+	{"d",	"(double)",					""},
+	{"s",	"(const char *)",			""},
+	{"p",	"(void *)(size_t)",			"ULL"},
+};
+
+#define NUM_TYPES	(sizeof(types) / sizeof(types[0]))
+
+
+static const char * corpus;
+static unsigned lineNumber;
+
+
+static void fail(const char * msg)
+{
+	fprintf(stderr,"%s:%u: %s\n",corpus,lineNumber,msg);
+	exit(1);
+}
+
+
+static char * skipBlank(char * s)
+{
+	while (*s == ' ' || *s == '\t')
+		s++;
+
+	return s;
+}
+
+
+/**
+ * Return the end of the C string literal starting at s.
+ */
+static char * scanLiteral(char * s)
+{
+	if (*s++ != '"')
+		fail("string literal expected");
+
+	while (*s != '"')
+	{
+		if (*s == 0 || *s == '\n')
+			fail("unterminated string literal");
+		if (*s == '\\' && *++s == 0)
+			fail("unterminated string literal");
+		s++;
+	}
+
+	return s + 1;
+}
+
+
+/**
+ * Return the end of one number or char literal, only the chars of a
+ * number are accepted so the corpus can not inject code.
+ */
+static char * scanValue(char * s,int chr)
+{
+	char * start = s;
+
+	if (chr && *s == '\'')
+	{
+		if (s[1] == '\\')
+			s++;
+		if (s[1] == 0 || s[2] != '\'')
+			fail("invalid char literal");
+		return s + 3;
+	}
+
+	while (isxdigit((unsigned char)*s) || *s == 'x' || *s == 'X' || *s == '.' || *s == '-' || *s == '+')
+		s++;
+
+	if (s == start)
+		fail("value expected");
+
+	return s;
+}
+
+
+/**
+ * Write the function of one record.
+ *
+ * @return 0 if the line is empty or a comment.
+ */
+static int record(char * line,unsigned n,unsigned long * weight)
+{
+	const struct type_s * t;
+	char * s = skipBlank(line);
+	char * e;
+	char * fmt;
+	unsigned i;
+
+	if (*s == '#' || *s == '\n' || *s == '\r' || *s == 0)
+		return 0;
+
+	*weight = strtoul(s,&e,10);
+	if (e == s)
+		fail("weight expected");
+
+	s = skipBlank(e);
+	fmt = s;
+	s = scanLiteral(s);
+
+	printf("static int record%u(format_t format,char * buf)\n{\n\treturn (*format)(buf,REPLAY_SIZE,%.*s",n,(int)(s - fmt),fmt);
+
+	for (;;)
+	{
+		s = skipBlank(s);
+		if (*s == '\n' || *s == '\r' || *s == 0)
+			break;
+
+		for (e = s ; isalpha((unsigned char)*e) ; e++)
+		{
+		}
+
+		if (*e != ':')
+			fail("type:value expected");
+
+		for (i = 0 ; i < NUM_TYPES ; i++)
+		{
+			if ((size_t)(e - s) == strlen(types[i].name) && strncmp(s,types[i].name,(size_t)(e - s)) == 0)
+				break;
+		}
+
+		if (i == NUM_TYPES)
+			fail("unknown type");
+
+		t = &types[i];
+		s = e + 1;
+
+		if (*t->name == 's' && strncmp(s,"NULL",4) == 0)
+		{
+			printf(",%s0",t->cast);
+			s += 4;
+		}
+		else if (*t->name == 's')
+		{
+			e = scanLiteral(s);
+			printf(",%s%.*s",t->cast,(int)(e - s),s);
+			s = e;
+		}
+		else
+		{
+			e = scanValue(s,*t->name == 'c');
+			/* Char and floating point literals have no suffix */
+			printf(",%s%.*s%s",t->cast,(int)(e - s),s,*s == '\'' || memchr(s,'.',(size_t)(e - s)) != 0 ? "" : t->suffix);
+			s = e;
+		}
+
+		if (*s != ' ' && *s != '\t' && *s != '\n' && *s != '\r' && *s != 0)
+			fail("invalid value");
+	}
+
+	printf(");\n}\n\n");
+
+	/* The format is also the name of the record */
+	printf("#define RECORD%u_FMT\t%.*s\n\n",n,(int)(scanLiteral(fmt) - fmt),fmt);
+
+	return 1;
+}
+
+
+int main(int argc,char **argv)
+{
+	static char line[MAX_LINE];
+	unsigned long * weights;
+	unsigned n = 0;
+	unsigned i;
+	FILE * file;
+
+	if (argc != 2)
+	{
+		printf("usage: xformatcorpus corpus.txt > xformatreplay.inc\n");
+		exit(1);
+	}
+
+	corpus = argv[1];
+	file = fopen(corpus,"r");
+	weights = (unsigned long *)malloc(sizeof(unsigned long) * MAX_RECORDS);
+	if (file == 0 || weights == 0)
+	{
+		perror(corpus);
+		exit(1);
+	}
+
+	printf("/* Generated by xformatcorpus from %s, do not edit */\n\n",corpus);
+
+	while (fgets(line,sizeof(line),file) != 0)
+	{
+		lineNumber++;
+		if (strchr(line,'\n') == 0 && !feof(file))
+			fail("line too long");
+
+		if (n == MAX_RECORDS)
+			fail("too many records");
+
+		if (record(line,n,&weights[n]))
+			n++;
+	}
+
+	fclose(file);
+
+	if (n == 0)
+	{
+		lineNumber = 0;
+		fail("no records");
+	}
+
+	printf("static const struct record_s records[] =\n{\n");
+	for (i = 0 ; i < n ; i++)
+	{
+		printf("\t{RECORD%u_FMT,%lu,record%u},\n",i,weights[i],i);
+	}
+	printf("};\n");
+
+	free(weights);
+
+	return 0;
+}
@@ -0,0 +1,300 @@
+/**
+ * @file        xformatcpptest.cpp
+ *
+ * @brief       Test for the C++ interface xformatc.hpp
+ *
+ *
+ * @author      Mario Viara
+ *
+ * @version     1.00
+ *
+ * @copyright   Copyright Mario Viara 2014  - License Open Source (LGPL)
+ * This is a free software and is opened for education, research and commercial
+ * developments under license policy of following terms:
+ * - This is a free software and there is NO WARRANTY.
+ * - No restriction on use. You can use, modify and redistribute it for personal,
+ *   non-profit or commercial product UNDER YOUR RESPONSIBILITY.
+ * - Redistributions of source code must retain the above copyright notice.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+
+#include "xformatc.hpp"
+
+
+/**
+ * Format the same arguments with the C++ and the C interface
+ */
+#define TEST(fmt,...) test(xformatc::snformat(buf1,sizeof(buf1),XFORMAT_FMT(fmt),__VA_ARGS__),xsnformat(buf2,sizeof(buf2),fmt,__VA_ARGS__),fmt)
+
+static char buf1[256];
+static char buf2[256];
+
+static void test(unsigned count1,unsigned count2,const char * fmt)
+{
+	if (count1 != count2 || strcmp(buf1,buf2))
+	{
+		fprintf(stderr,"C++     : '%s' (%u)\nXFormat : '%s' (%u)\nFormat  : '%s' failed\n",buf1,count1,buf2,count2,fmt);
+		exit(1);
+	}
+
+	printf("'%s'\n",buf1);
+}
+
+
+static void myWrite(void * arg,const char * p,size_t n)
+{
+	char ** s = static_cast<char **>(arg);
+
+	memcpy(*s,p,n);
+	*s += n;
+}
+
+
+/*
+ * Arguments checked at compile time
+ */
+static auto fmtInt = XFORMAT_FMT("%d %5u %x");
+static auto fmtStar = XFORMAT_FMT("%*.*s");
+static auto fmtLong = XFORMAT_FMT("%ld %lu %zu");
+static auto fmtPtr = XFORMAT_FMT("%p %B %%");
+static auto fmtView = XFORMAT_FMT("%*.*v %V");
+
+static_assert(xformatc::valid<decltype(fmtInt),int,unsigned,short>(),"int");
+static_assert(!xformatc::valid<decltype(fmtInt),int,unsigned>(),"too few arguments");
+static_assert(!xformatc::valid<decltype(fmtInt),int,unsigned,int,int>(),"too many arguments");
+static_assert(!xformatc::valid<decltype(fmtInt),const char *,unsigned,int>(),"string for %d");
+static_assert(!xformatc::valid<decltype(fmtInt),double,unsigned,int>(),"double for %d");
+static_assert(!xformatc::valid<decltype(fmtInt),bool,unsigned,int>(),"bool for %d");
+static_assert(xformatc::valid<decltype(fmtStar),int,int,const char *>(),"star");
+static_assert(xformatc::valid<decltype(fmtStar),int,int,char[4]>(),"char array");
+static_assert(!xformatc::valid<decltype(fmtStar),int,const char *>(),"missing star");
+static_assert(xformatc::valid<decltype(fmtLong),long,unsigned long,size_t>(),"long");
+static_assert(!xformatc::valid<decltype(fmtPtr),int,bool>(),"int for %p");
+static_assert(xformatc::valid<decltype(fmtPtr),int *,bool>(),"pointer");
+static_assert(xformatc::valid<decltype(fmtView),int,int,const char *,size_t,char *,unsigned>(),"view");
+static_assert(!xformatc::valid<decltype(fmtView),int,int,const char *,const char *,size_t>(),"view without length");
+#if XCFG_FORMAT_LONGLONG && XCFG_FORMAT_LONG
+static auto fmtLongLong = XFORMAT_FMT("%lld %llx");
+static_assert(xformatc::valid<decltype(fmtLongLong),long long,uint64_t>(),"long long");
+#endif
+#if XCFG_FORMAT_FLOAT
+static auto fmtFloat = XFORMAT_FMT("%f %.3e %g");
+static_assert(xformatc::valid<decltype(fmtFloat),double,float,double>(),"double");
+static_assert(!xformatc::valid<decltype(fmtFloat),double,int,double>(),"int for %e");
+static_assert(!xformatc::valid<decltype(fmtFloat),long double,double,double>(),"long double");
+#endif
+static auto fmtInvalid = XFORMAT_FMT("%y");
+static auto fmtPercent = XFORMAT_FMT("%5%");
+static auto fmtEnd = XFORMAT_FMT("end %");
+static_assert(!xformatc::valid<decltype(fmtInvalid)>(),"invalid conversion");
+static_assert(!xformatc::valid<decltype(fmtPercent)>(),"invalid %");
+static_assert(!xformatc::valid<decltype(fmtEnd)>(),"unterminated");
+
+/*
+ * Program built at compile time
+ */
+constexpr auto & progInt = xformatc::detail::programOf<decltype(fmtInt)>;
+static_assert(progInt.count == 5 && progInt.spec[4].literal == nullptr,"program steps");
+static_assert(progInt.spec[1].type == 'd' && progInt.spec[1].litlen == 1,"program %d");
+static_assert(progInt.spec[2].type == 'u' && progInt.spec[2].width == 5,"program %5u");
+static_assert(progInt.spec[3].type == 'x' && progInt.spec[3].radix == 16,"program %x");
+static_assert(xformatc::detail::programOf<decltype(fmtStar)>.spec[1].prec == XFORMAT_SPEC_ARG,"program %*.*s");
+
+
+/**
+ * Compare the program built by the constexpr parser with xformat_compile
+ */
+static bool sameProgram(const char * fmt)
+{
+	struct xformat_spec_s prog[8];
+	const auto p = xformatc::detail::compile<8>(fmt);
+	unsigned n = xformat_compile(fmt,prog,8);
+	unsigned i;
+
+	if (n != p.count)
+		return false;
+
+	for (i = 0 ; i < n ; i++)
+	{
+		const struct xformat_spec_s & a = p.spec[i];
+		const struct xformat_spec_s & b = prog[i];
+
+		if (a.literal != b.literal || a.litlen != b.litlen || a.type != b.type)
+			return false;
+
+		if (a.type && (a.flags != b.flags || a.width != b.width || a.prec != b.prec || a.radix != b.radix ||
+			a.pad != b.pad || a.prefixlen != b.prefixlen || memcmp(a.prefix,b.prefix,(size_t)a.prefixlen)))
+			return false;
+	}
+
+	return true;
+}
+
+
+/**
+ * All the specifiers of up to 3 chars after the %, so each transition
+ * of the C++ machine is compared with formatStates.
+ */
+static void testPrograms()
+{
+	static const char * const formats[] =
+	{
+		"", "text", "%", "%%", "%%d", "%d%", "%-08.3ld|", "%#lx %#o %#b %#X", "%+ 5i", "%05.*f",
+		"%*.*s", "%zu %zd %lld %llu", "%p %P %B %c %C", "%-10.3v %V", "%.e %G %5.0g", "%y %5% %l", "%123456789d", "\xe9%\xe9" "d %5\xe9",
+	};
+	char fmt[8];
+	unsigned count = 0;
+	unsigned i;
+	int c1,c2,c3;
+
+	for (i = 0 ; i < sizeof(formats) / sizeof(formats[0]) ; i++)
+	{
+		if (!sameProgram(formats[i]))
+		{
+			fprintf(stderr,"Program of '%s' failed\n",formats[i]);
+			exit(1);
+		}
+	}
+
+	fmt[0] = '%';
+	for (c1 = ' ' - 1 ; c1 <= 'z' + 1 ; c1++)
+	{
+		for (c2 = ' ' - 1 ; c2 <= 'z' + 1 ; c2++)
+		{
+			for (c3 = ' ' - 1 ; c3 <= 'z' + 1 ; c3++)
+			{
+				fmt[1] = (char)c1;
+				fmt[2] = (char)c2;
+				fmt[3] = (char)c3;
+				fmt[4] = 'x';
+				fmt[5] = 0;
+
+				if (!sameProgram(fmt))
+				{
+					fprintf(stderr,"Program of '%s' failed\n",fmt);
+					exit(1);
+				}
+				count++;
+			}
+		}
+	}
+
+	printf("Program of %u formats same of xformat_compile\n",count);
+}
+
+
+int main()
+{
+	const char * str = "string";
+	char array[] = "array";
+	int value = 42;
+	char * s;
+
+	printf("XFORMATC C++ test\n\n");
+
+	testPrograms();
+
+	TEST("Integer %d %i %u %5d %-5d| %05d %+d % d",-1,2,3u,4,-5,6,7,8);
+	TEST("Radix %x %X %#x %o %#o %b %#b",0xabcu,0xdefu,255u,8u,8u,5u,6u);
+	TEST("Size %hd %hu",(short)-3,(unsigned short)65535);
+	TEST("Star %*d %-*d| %.*d %*.*s|",6,12,5,-3,4,7,8,3,"truncate");
+	TEST("String %s %S %10s %-10s| %s",str,"upper",array,"left",(const char *)0);
+	TEST("Char %c%c%C %B %B %%",'a',98,'c',true,0);
+	TEST("View %v %.3V %-6v|",str,(size_t)3,"upper",(size_t)5,array,sizeof(array) - 1);
+	TEST("Pointer %p %P",static_cast<void *>(&value),static_cast<const int *>(&value));
+	TEST("Long %ld %lu %lx %zu %zd",-123456L,123456UL,0xfedcbaUL,sizeof(buf1),(size_t)-1);
+#if XCFG_FORMAT_LONGLONG && XCFG_FORMAT_LONG
+	TEST("Long long %lld %llu %#llx %llb",-1234567890123LL,18446744073709551615ULL,0x123456789abcdefULL,0xf0f0ULL);
+#endif
+#if XCFG_FORMAT_FLOAT
+	TEST("Float %f %.2f %10.3f %-8.1f| %e %.3E %g %G",3.25,-1.005,2.0 / 3.0,0.25,6.02e23,1e-9,0.0001,1e20);
+#endif
+
+	/* Arguments converted to the type read by the specifier */
+	xformatc::snformat(buf1,sizeof(buf1),XFORMAT_FMT("%d %ld %u %c"),(short)-2,-3,(unsigned char)200,(char)'x');
+	if (strcmp(buf1,"-2 -3 200 x"))
+	{
+		fprintf(stderr,"Conversion '%s' failed\n",buf1);
+		exit(1);
+	}
+	printf("'%s'\n",buf1);
+
+	/* Truncation and output function */
+	if (xformatc::snformat(buf1,8,XFORMAT_FMT("Trunc %s"),"string") != 12 || strcmp(buf1,"Trunc s"))
+	{
+		fprintf(stderr,"Truncation '%s' failed\n",buf1);
+		exit(1);
+	}
+	printf("'%s'\n",buf1);
+
+	s = buf2;
+	if (xformatc::format(myWrite,&s,XFORMAT_FMT("Write %d %s"),value,str) != 15 || (*s = 0,strcmp(buf2,"Write 42 string")))
+	{
+		fprintf(stderr,"Write '%s' failed\n",buf2);
+		exit(1);
+	}
+	printf("'%s'\n",buf2);
+
+#if XCFG_FORMAT_ARGS
+	/* Format known at run time, arguments typed by the C++ type */
+	{
+		enum colors_e { red,green,blue };
+		const char * runtime = str[0] == 's' ? "Typed %d %u %x %s %c|%5d|%B" : "";
+
+		s = buf1;
+		unsigned count = xformatc::xformat([&s](const char * p,std::size_t n) { memcpy(s,p,n); s += n; },runtime,
+			-12,3000000000u,(unsigned char)255,str,'z',blue,true);
+		*s = 0;
+
+		if (count != strlen(buf1) || strcmp(buf1,"Typed -12 3000000000 ff string z|    2|True"))
+		{
+			fprintf(stderr,"Typed '%s' (%u) failed\n",buf1,count);
+			exit(1);
+		}
+		printf("'%s'\n",buf1);
+
+		/* The size modifier is not required and missing arguments are 0 */
+		s = buf1;
+#if XCFG_FORMAT_LONGLONG
+		xformatc::xformat([&s](const char * p,std::size_t n) { memcpy(s,p,n); s += n; },"%d %x %p %s|%d",1LL << 40,~0ULL,&value,array);
+		*s = 0;
+		xsnformat(buf2,sizeof(buf2),"%lld %llx %p %s|%d",1LL << 40,~0ULL,static_cast<void *>(&value),array,0);
+#else
+		xformatc::xformat([&s](const char * p,std::size_t n) { memcpy(s,p,n); s += n; },"%d %x %p %s|%d",1L << 20,~0UL,&value,array);
+		*s = 0;
+		xsnformat(buf2,sizeof(buf2),"%ld %lx %p %s|%d",1L << 20,~0UL,static_cast<void *>(&value),array,0);
+#endif
+		if (strcmp(buf1,buf2))
+		{
+			fprintf(stderr,"Typed   : '%s'\nXFormat : '%s' failed\n",buf1,buf2);
+			exit(1);
+		}
+		printf("'%s'\n",buf1);
+
+#if XCFG_FORMAT_FLOAT
+		s = buf1;
+		xformatc::xformat([&s](const char * p,std::size_t n) { memcpy(s,p,n); s += n; },"%.3f %e %d",2.0f / 3.0f,1e-9,-4.5);
+		*s = 0;
+		xsnformat(buf2,sizeof(buf2),"%.3f %e %d",(double)(2.0f / 3.0f),1e-9,-4);
+		if (strcmp(buf1,buf2))
+		{
+			fprintf(stderr,"Typed   : '%s'\nXFormat : '%s' failed\n",buf1,buf2);
+			exit(1);
+		}
+		printf("'%s'\n",buf1);
+#endif
+	}
+#endif
+
+	fprintf(stderr,"\nTest completed successfully\n");
+
+	return 0;
+}
@@ -0,0 +1,245 @@
+/**
+ * @file        xformatfd.c
+ *
+ * @brief       Buffered file descriptor sink for xformatc.
+ *
+ * The runs of chars emitted by xvformat_write are copied in a buffer
+ * supplied by the caller, many records are written to the file
+ * descriptor with one system call. When one run does not fit in the
+ * buffer the buffered records and the run are written together by one
+ * writev without copying the run.
+ *
+ * The buffer is flushed when full, after each record with a new line
+ * (XFORMAT_FD_LINE) or after the first record written when the interval
+ * is elapsed from the last flush (XFORMAT_FD_TIME), the time is checked
+ * only when one record is written, no thread is used.
+ *
+ * This module require POSIX, it is not part of the core library.
+ *
+ * @author      Mario Viara
+ *
+ * @copyright   Copyright Mario Viara 2014  - License Open Source (LGPL)
+ * This is a free software and is opened for education, research and commercial
+ * developments under license policy of following terms:
+ * - This is a free software and there is NO WARRANTY.
+ * - No restriction on use. You can use, modify and redistribute it for personal,
+ *   non-profit or commercial product UNDER YOUR RESPONSIBILITY.
+ * - Redistributions of source code must retain the above copyright notice.
+ *
+ * To contact the author send an email to mario_at_viara.eu*
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include "xformatfd.h"
+
+
+/**
+ * Monotonic time in ns
+ */
+static unsigned long long fdNow(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+}
+
+
+/**
+ * Write a set of buffers handling the partial writes.
+ */
+static void fdWrite(struct xformat_fd_s * sink,struct iovec * iov,int n)
+{
+	ssize_t r;
+
+	while (n > 0 && iov->iov_len == 0)
+	{
+		iov++;
+		n--;
+	}
+
+	while (n > 0)
+	{
+		sink->writes++;
+		r = writev(sink->fd,iov,n);
+		if (r < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			if (sink->error == 0)
+				sink->error = errno;
+			return;
+		}
+
+		while (n > 0 && (size_t)r >= iov->iov_len)
+		{
+			r -= (ssize_t)iov->iov_len;
+			iov++;
+			n--;
+		}
+
+		if (n > 0)
+		{
+			iov->iov_base = (char *)iov->iov_base + r;
+			iov->iov_len -= (size_t)r;
+		}
+	}
+}
+
+
+/**
+ * Write the buffer and the optional run p,n with one system call.
+ */
+static void fdFlush(struct xformat_fd_s * sink,const char * p,size_t n)
+{
+	struct iovec iov[2];
+
+	iov[0].iov_base = sink->buf;
+	iov[0].iov_len = sink->len;
+	iov[1].iov_base = (void *)p;
+	iov[1].iov_len = n;
+
+	fdWrite(sink,iov,2);
+
+	sink->len = 0;
+	if (sink->policy == XFORMAT_FD_TIME)
+		sink->last = fdNow();
+}
+
+
+/**
+ * Output function for xvformat_write
+ */
+static void fdOutput(void * arg,const char * p,size_t n)
+{
+	struct xformat_fd_s * sink = (struct xformat_fd_s *)arg;
+
+	if (sink->policy == XFORMAT_FD_LINE && !sink->line && memchr(p,'\n',n) != 0)
+		sink->line = 1;
+
+	if (n <= sink->size - sink->len)
+	{
+		memcpy(sink->buf + sink->len,p,n);
+		sink->len += n;
+	}
+	else
+		fdFlush(sink,p,n);
+}
+
+
+/**
+ * Initialize one file descriptor sink.
+ *
+ * @param sink		- Sink to initialize.
+ * @param fd		- Destination file descriptor.
+ * @param buf		- Buffer for the records.
+ * @param size		- Size of the buffer.
+ * @param policy	- XFORMAT_FD_FULL, XFORMAT_FD_LINE or XFORMAT_FD_TIME.
+ * @param interval	- Interval in ms for XFORMAT_FD_TIME.
+ */
+void xformat_fd_init(struct xformat_fd_s * sink,int fd,char * buf,size_t size,int policy,unsigned interval)
+{
+	sink->fd = fd;
+	sink->policy = policy;
+	sink->buf = buf;
+	sink->size = size;
+	sink->len = 0;
+	sink->line = 0;
+	sink->interval = (unsigned long long)interval * 1000000ULL;
+	sink->last = policy == XFORMAT_FD_TIME ? fdNow() : 0;
+	sink->writes = 0;
+	sink->error = 0;
+}
+
+
+/**
+ * Format one record in the sink.
+ *
+ * @param sink	- File descriptor sink.
+ * @param fmt	- Format options for the list of parameters.
+ * @param args	- List parameters.
+ *
+ * @return The number of char emitted.
+ */
+unsigned xvformat_fd(struct xformat_fd_s * sink,const char * fmt,va_list args)
+{
+	unsigned count;
+
+	sink->line = 0;
+	count = xvformat_write(fdOutput,(void *)sink,fmt,args);
+
+	switch (sink->policy)
+	{
+		case XFORMAT_FD_LINE:
+			if (sink->line && sink->len)
+				fdFlush(sink,0,0);
+			break;
+
+		case XFORMAT_FD_TIME:
+			if (sink->len && fdNow() - sink->last >= sink->interval)
+				fdFlush(sink,0,0);
+			break;
+
+		default:
+			break;
+	}
+
+	return count;
+}
+
+
+/**
+ * Format one record in the sink.
+ *
+ * @param sink	- File descriptor sink.
+ * @param fmt	- Format options for the list of parameters.
+ * @param ...	- Arguments
+ *
+ * @return The number of char emitted.
+ *
+ * @see xvformat_fd
+ */
+unsigned xformat_fd(struct xformat_fd_s * sink,const char * fmt,...)
+{
+	va_list list;
+	unsigned count;
+
+	va_start(list,fmt);
+	count = xvformat_fd(sink,fmt,list);
+	va_end(list);
+
+	(void)list;
+
+	return count;
+}
+
+
+/**
+ * Write all the buffered records.
+ *
+ * @param sink	- File descriptor sink.
+ *
+ * @return 0 or the errno of the first write failed after the last call,
+ * the records not written are lost.
+ */
+int xformat_fd_flush(struct xformat_fd_s * sink)
+{
+	int error;
+
+	if (sink->len)
+		fdFlush(sink,0,0);
+
+	error = sink->error;
+	sink->error = 0;
+
+	return error;
+}
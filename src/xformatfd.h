@@ -0,0 +1,73 @@
+/**
+ * @file        xformatfd.h
+ *
+ * @brief       Buffered file descriptor sink for xformatc.
+ *
+ * @author      Mario Viara
+ *
+ * @copyright   Copyright Mario Viara 2014  - License Open Source (LGPL)
+ * This is a free software and is opened for education, research and commercial
+ * developments under license policy of following terms:
+ * - This is a free software and there is NO WARRANTY.
+ * - No restriction on use. You can use, modify and redistribute it for personal,
+ *   non-profit or commercial product UNDER YOUR RESPONSIBILITY.
+ * - Redistributions of source code must retain the above copyright notice.
+ *
+ * To contact the author send an email to mario_at_viara.eu*
+ */
+#ifndef XFORMATFD_H
+#define XFORMATFD_H
+#include "xformatc.h"
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Policy used to flush the buffer
+ */
+#define XFORMAT_FD_FULL		0	/* Only when the buffer is full			*/
+#define XFORMAT_FD_LINE		1	/* After each record with a new line	*/
+#define XFORMAT_FD_TIME		2	/* After a record when the interval is
+								 * elapsed from the last flush			*/
+
+
+/**
+ * File descriptor sink, the buffer is supplied by the caller and the
+ * fields are private to xformatfd.c. One sink must not be used at the
+ * same time by two threads.
+ */
+struct xformat_fd_s
+{
+	int				fd;
+	int				policy;
+	char *			buf;
+	size_t			size;
+	size_t			len;
+
+	/** Set by the output function when the record has a new line */
+	int				line;
+
+	/** Interval and time of the last flush in ns for XFORMAT_FD_TIME */
+	unsigned long long	interval;
+	unsigned long long	last;
+
+	/** System calls done and errors */
+	unsigned long	writes;
+	int				error;
+};
+
+
+void xformat_fd_init(struct xformat_fd_s * sink,int fd,char * buf,size_t size,int policy,unsigned interval);
+
+unsigned xformat_fd(struct xformat_fd_s * sink,const char * fmt,...);
+
+unsigned xvformat_fd(struct xformat_fd_s * sink,const char * fmt,va_list args);
+
+int xformat_fd_flush(struct xformat_fd_s * sink);
+
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
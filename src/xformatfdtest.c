@@ -0,0 +1,195 @@
+/**
+ * @file        xformatfdtest.c
+ *
+ * @brief       Test and throughput of the file descriptor sink xformatfd.c
+ *
+ *
+ * @author      Mario Viara
+ *
+ * @version     1.00
+ *
+ * @copyright   Copyright Mario Viara 2014  - License Open Source (LGPL)
+ * This is a free software and is opened for education, research and commercial
+ * developments under license policy of following terms:
+ * - This is a free software and there is NO WARRANTY.
+ * - No restriction on use. You can use, modify and redistribute it for personal,
+ *   non-profit or commercial product UNDER YOUR RESPONSIBILITY.
+ * - Redistributions of source code must retain the above copyright notice.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include "xformatfd.h"
+
+#define FMT		"R%06ld %s %5d|%x\n"
+
+static const char payload[] = "the quick brown fox jump over the lazy dog";
+static char big[10000];
+static long records;
+
+
+/**
+ * Output function using stdio one char at time
+ */
+static void outFile(void * arg,char c)
+{
+	fputc(c,(FILE *)arg);
+}
+
+
+/**
+ * Check the content of the file is the sequence of records, one every
+ * 1000 records is followed by the big record.
+ */
+static int checkOutput(FILE * file)
+{
+	char line[sizeof(big) + 64];
+	char ref[128];
+	long i;
+
+	rewind(file);
+
+	for (i = 0 ; i < records ; i++)
+	{
+		xsnformat(ref,sizeof(ref),FMT,i,payload,(int)(i & 0xffff),(unsigned)i);
+		if (fgets(line,sizeof(line),file) == 0 || strcmp(line,ref))
+		{
+			fprintf(stderr,"Invalid record %ld\n",i);
+			return 1;
+		}
+
+		if (i % 1000 == 999 && (fgets(line,sizeof(line),file) == 0 || strncmp(line,big,sizeof(big) - 1) || line[sizeof(big) - 1] != '\n'))
+		{
+			fprintf(stderr,"Invalid big record %ld\n",i);
+			return 1;
+		}
+	}
+
+	if (fgets(line,sizeof(line),file) != 0)
+	{
+		fprintf(stderr,"Extra records\n");
+		return 1;
+	}
+
+	return 0;
+}
+
+
+/**
+ * Write all the records with one policy of the fd sink or with stdio
+ * when policy is negative.
+ */
+static int testFd(const char * name,int policy,size_t size,unsigned interval)
+{
+	struct xformat_fd_s sink;
+	struct timeval start,now;
+	double elapsed;
+	char * buf;
+	FILE * file;
+	long i;
+
+	file = tmpfile();
+	buf = malloc(size);
+	if (file == 0 || buf == 0)
+	{
+		perror("tmpfile");
+		return 1;
+	}
+
+	printf("Starting test for %s ... ",name);
+	fflush(stdout);
+	gettimeofday(&start,0);
+
+	xformat_fd_init(&sink,fileno(file),buf,size,policy,interval);
+
+	for (i = 0 ; i < records ; i++)
+	{
+		if (policy < 0)
+			xformat(outFile,file,FMT,i,payload,(int)(i & 0xffff),(unsigned)i);
+		else
+			xformat_fd(&sink,FMT,i,payload,(int)(i & 0xffff),(unsigned)i);
+
+		if (i % 1000 == 999)
+		{
+			if (policy < 0)
+				xformat(outFile,file,"%s\n",big);
+			else
+				xformat_fd(&sink,"%s\n",big);
+		}
+	}
+
+	if (policy < 0)
+		fflush(file);
+	else if (xformat_fd_flush(&sink))
+	{
+		fprintf(stderr,"%s write failed\n",name);
+		return 1;
+	}
+
+	gettimeofday(&now,0);
+	elapsed = ((double)now.tv_sec * 1000000.0 + now.tv_usec) - ((double)start.tv_sec * 1000000.0 + start.tv_usec);
+	elapsed /= 1000000.0;
+
+	printf(" Elapsed %.3f second(s) %.0f records/s write %lu\n",elapsed,(double)records / elapsed,sink.writes);
+	fflush(stdout);
+
+	if (checkOutput(file))
+	{
+		fprintf(stderr,"%s failed\n",name);
+		return 1;
+	}
+
+	/* One system call for each record, two for the big records */
+	if ((policy == XFORMAT_FD_LINE || (policy == XFORMAT_FD_TIME && interval == 0)) &&
+		sink.writes != (unsigned long)(records + records / 1000 * 2))
+	{
+		fprintf(stderr,"%s %lu write for %ld records\n",name,sink.writes,records);
+		return 1;
+	}
+
+	fclose(file);
+	free(buf);
+
+	return 0;
+}
+
+
+int main(int argc,char **argv)
+{
+	records = 1000000;
+
+	if (argc > 1)
+		records = atol(argv[1]);
+
+	if (records < 1)
+	{
+		printf("usage: xformatfdtest [records]\n");
+		exit(1);
+	}
+
+	memset(big,'x',sizeof(big) - 1);
+
+	printf("Test fd sink using %ld records\n",records);
+
+	if (testFd("stdio fputc       ",-1,1,0) ||
+		testFd("Full 64 KB        ",XFORMAT_FD_FULL,65536,0) ||
+		testFd("Full 256 B        ",XFORMAT_FD_FULL,256,0) ||
+		testFd("Line              ",XFORMAT_FD_LINE,4096,0) ||
+		testFd("Time 0 ms         ",XFORMAT_FD_TIME,4096,0) ||
+		testFd("Time 10 ms        ",XFORMAT_FD_TIME,65536,10))
+	{
+		exit(1);
+	}
+
+	fprintf(stderr,"\nTest completed successfully\n");
+
+	return 0;
+}
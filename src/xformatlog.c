@@ -0,0 +1,428 @@
+/**
+ * @file        xformatlog.c
+ *
+ * @brief       Multi producer log sink for xformatc.
+ *
+ * Records are formatted by the producers directly in the slots of a
+ * bounded ring, one slot for each record, and written by a background
+ * thread to a file descriptor with one writev for many records.
+ *
+ * Each slot has a sequence number : it is equal to the position of the
+ * ring when the slot is free for that position and to the position + 1
+ * when the record is ready. The producers reserve one position with an
+ * atomic fetch-add, or with a compare and swap only when the slot is
+ * free if the policy is XFORMAT_LOG_DROP, so no lock is used.
+ *
+ * This module require POSIX threads and the gcc atomic builtins, it is
+ * not part of the core library.
+ *
+ * @author      Mario Viara
+ *
+ * @copyright   Copyright Mario Viara 2014  - License Open Source (LGPL)
+ * This is a free software and is opened for education, research and commercial
+ * developments under license policy of following terms:
+ * - This is a free software and there is NO WARRANTY.
+ * - No restriction on use. You can use, modify and redistribute it for personal,
+ *   non-profit or commercial product UNDER YOUR RESPONSIBILITY.
+ * - Redistributions of source code must retain the above copyright notice.
+ *
+ * To contact the author send an email to mario_at_viara.eu*
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include "xformatlog.h"
+
+
+/**
+ * Max number of records written with one writev
+ */
+#ifndef XCFG_FORMAT_LOG_BATCH
+#define XCFG_FORMAT_LOG_BATCH	64
+#endif
+
+/**
+ * Time in ns the background thread sleep when the ring is empty
+ */
+#ifndef XCFG_FORMAT_LOG_IDLE
+#define XCFG_FORMAT_LOG_IDLE	100000
+#endif
+
+/**
+ * Number of times the background thread yield the cpu before sleeping
+ * when the ring is empty.
+ */
+#ifndef XCFG_FORMAT_LOG_SPIN
+#define XCFG_FORMAT_LOG_SPIN	64
+#endif
+
+/**
+ * Slots and positions are aligned to one cache line
+ */
+#define LOG_LINE		64
+
+/**
+ * Max number of slots, the distance between two positions must fit
+ * in an int.
+ */
+#define LOG_MAX_SLOTS	(~0u / 2 + 1)
+
+
+/**
+ * Header of one slot, the text of the record follow the header
+ */
+struct slot_s
+{
+	unsigned	seq;
+	unsigned	len;
+};
+
+#define SLOT(log,pos)	((struct slot_s *)((log)->slots + (size_t)((pos) & (log)->mask) * (log)->stride))
+#define SLOT_TEXT(slot)	((char *)(slot) + sizeof(struct slot_s))
+
+
+struct xformat_log_s
+{
+	/** Next position reserved by the producers */
+	unsigned		head;
+	char			pad0[LOG_LINE - sizeof(unsigned)];
+
+	/** Records dropped or that waited for a free slot */
+	unsigned long	overflow;
+	unsigned long	waits;
+	char			pad1[LOG_LINE - 2 * sizeof(unsigned long)];
+
+	/** Records not written and errno of the last write error */
+	unsigned long	failed;
+	int				error;
+
+	/** Set to stop the background thread */
+	int				stop;
+
+	/** Storage of the slots */
+	char *			slots;
+	size_t			stride;
+	unsigned		mask;
+
+	/** Max size of one record including the nul char */
+	unsigned		size;
+
+	int				fd;
+	int				policy;
+	pthread_t		thread;
+};
+
+
+/**
+ * Write a set of records handling the partial writes.
+ *
+ * @return The number of records not written or partially written.
+ */
+static int logWrite(struct xformat_log_s * log,struct iovec * iov,int n)
+{
+	ssize_t r;
+
+	while (n > 0)
+	{
+		r = writev(log->fd,iov,n);
+		if (r < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			__atomic_store_n(&log->error,errno,__ATOMIC_RELAXED);
+			return n;
+		}
+
+		while (n > 0 && (size_t)r >= iov->iov_len)
+		{
+			r -= (ssize_t)iov->iov_len;
+			iov++;
+			n--;
+		}
+
+		if (n > 0)
+		{
+			iov->iov_base = (char *)iov->iov_base + r;
+			iov->iov_len -= (size_t)r;
+		}
+	}
+
+	return 0;
+}
+
+
+/**
+ * Background thread, drain the ready records in order.
+ */
+static void * logFlusher(void * arg)
+{
+	struct xformat_log_s * log = (struct xformat_log_s *)arg;
+	struct iovec iov[XCFG_FORMAT_LOG_BATCH];
+	struct timespec idle;
+	struct slot_s * slot;
+	unsigned tail = 0;
+	int spin = 0;
+	int stop,i,n,lost;
+
+	idle.tv_sec = 0;
+	idle.tv_nsec = XCFG_FORMAT_LOG_IDLE;
+
+	for (;;)
+	{
+		stop = __atomic_load_n(&log->stop,__ATOMIC_ACQUIRE);
+
+		for (n = 0 ; n < XCFG_FORMAT_LOG_BATCH ; n++)
+		{
+			slot = SLOT(log,tail + n);
+			if (__atomic_load_n(&slot->seq,__ATOMIC_ACQUIRE) != tail + n + 1)
+				break;
+			iov[n].iov_base = SLOT_TEXT(slot);
+			iov[n].iov_len = slot->len;
+		}
+
+		if (n == 0)
+		{
+			/* Empty after the stop request, all records are written */
+			if (stop)
+				break;
+			if (spin < XCFG_FORMAT_LOG_SPIN)
+			{
+				spin++;
+				sched_yield();
+			}
+			else
+				nanosleep(&idle,0);
+			continue;
+		}
+
+		spin = 0;
+
+		lost = logWrite(log,iov,n);
+		if (lost)
+			__atomic_store_n(&log->failed,log->failed + (unsigned long)lost,__ATOMIC_RELAXED);
+
+		/* Release the slots for the next turn of the ring */
+		for (i = 0 ; i < n ; i++)
+		{
+			__atomic_store_n(&SLOT(log,tail)->seq,tail + log->mask + 1,__ATOMIC_RELEASE);
+			tail++;
+		}
+	}
+
+	return 0;
+}
+
+
+/**
+ * Open one log sink and start the background thread.
+ *
+ * @param fd		- Destination file descriptor.
+ * @param slots		- Number of records in the ring, rounded up to a power of 2.
+ * @param size		- Max size of one record, longer records are truncated.
+ * @param policy	- XFORMAT_LOG_DROP or XFORMAT_LOG_BLOCK.
+ *
+ * @return The log sink or null on error or if the ring is too large.
+ */
+struct xformat_log_s * xformat_log_open(int fd,unsigned slots,unsigned size,int policy)
+{
+	struct xformat_log_s * log;
+	size_t stride;
+	void * mem;
+	unsigned n,i;
+
+	if (slots > LOG_MAX_SLOTS || size < 2)
+		return 0;
+
+	for (n = 2 ; n < slots ; n <<= 1)
+	{
+	}
+
+	stride = (sizeof(struct slot_s) + size + LOG_LINE - 1) & ~(size_t)(LOG_LINE - 1);
+	if (stride < size || stride > ~(size_t)0 / n || posix_memalign(&mem,LOG_LINE,sizeof(struct xformat_log_s)))
+		return 0;
+
+	log = (struct xformat_log_s *)mem;
+	log->head = 0;
+	log->overflow = 0;
+	log->waits = 0;
+	log->failed = 0;
+	log->error = 0;
+	log->stop = 0;
+	log->mask = n - 1;
+	log->size = size;
+	log->stride = stride;
+	log->fd = fd;
+	log->policy = policy;
+
+	if (posix_memalign(&mem,LOG_LINE,log->stride * n))
+	{
+		free(log);
+		return 0;
+	}
+
+	log->slots = (char *)mem;
+	for (i = 0 ; i < n ; i++)
+	{
+		SLOT(log,i)->seq = i;
+	}
+
+	if (pthread_create(&log->thread,0,logFlusher,log))
+	{
+		free(log->slots);
+		free(log);
+		return 0;
+	}
+
+	return log;
+}
+
+
+/**
+ * Format one record in the log, can be called by any number of threads.
+ *
+ * @param log	- Log sink.
+ * @param fmt	- Format options for the list of parameters.
+ * @param args	- List parameters.
+ *
+ * @return The length of the record or 0 if it was dropped.
+ */
+unsigned xvformat_log(struct xformat_log_s * log,const char * fmt,va_list args)
+{
+	struct slot_s * slot;
+	unsigned pos,len;
+	int dif;
+
+	if (log->policy == XFORMAT_LOG_BLOCK)
+	{
+		pos = __atomic_fetch_add(&log->head,1,__ATOMIC_RELAXED);
+		slot = SLOT(log,pos);
+
+		if (__atomic_load_n(&slot->seq,__ATOMIC_ACQUIRE) != pos)
+		{
+			__atomic_fetch_add(&log->waits,1,__ATOMIC_RELAXED);
+			while (__atomic_load_n(&slot->seq,__ATOMIC_ACQUIRE) != pos)
+			{
+				sched_yield();
+			}
+		}
+	}
+	else
+	{
+		pos = __atomic_load_n(&log->head,__ATOMIC_RELAXED);
+
+		for (;;)
+		{
+			slot = SLOT(log,pos);
+			dif = (int)(__atomic_load_n(&slot->seq,__ATOMIC_ACQUIRE) - pos);
+
+			if (dif == 0)
+			{
+				if (__atomic_compare_exchange_n(&log->head,&pos,pos + 1,1,__ATOMIC_RELAXED,__ATOMIC_RELAXED))
+					break;
+			}
+			else if (dif < 0)
+			{
+				__atomic_fetch_add(&log->overflow,1,__ATOMIC_RELAXED);
+				return 0;
+			}
+			else
+				pos = __atomic_load_n(&log->head,__ATOMIC_RELAXED);
+		}
+	}
+
+	len = xvsnformat(SLOT_TEXT(slot),log->size,fmt,args);
+	if (len >= log->size)
+		len = log->size - 1;
+
+	slot->len = len;
+	__atomic_store_n(&slot->seq,pos + 1,__ATOMIC_RELEASE);
+
+	return len;
+}
+
+
+/**
+ * Format one record in the log.
+ *
+ * @param log	- Log sink.
+ * @param fmt	- Format options for the list of parameters.
+ * @param ...	- Arguments
+ *
+ * @return The length of the record or 0 if it was dropped.
+ *
+ * @see xvformat_log
+ */
+unsigned xformat_log(struct xformat_log_s * log,const char * fmt,...)
+{
+	va_list list;
+	unsigned len;
+
+	va_start(list,fmt);
+	len = xvformat_log(log,fmt,list);
+	va_end(list);
+
+	(void)list;
+
+	return len;
+}
+
+
+/**
+ * Number of records dropped because the ring was full with
+ * XFORMAT_LOG_DROP.
+ */
+unsigned long xformat_log_overflow(struct xformat_log_s * log)
+{
+	return __atomic_load_n(&log->overflow,__ATOMIC_RELAXED);
+}
+
+
+/**
+ * Number of records that waited for a free slot with XFORMAT_LOG_BLOCK,
+ * none of them is lost.
+ */
+unsigned long xformat_log_waits(struct xformat_log_s * log)
+{
+	return __atomic_load_n(&log->waits,__ATOMIC_RELAXED);
+}
+
+
+/**
+ * Number of records lost or partially written because the write to
+ * the file descriptor failed.
+ *
+ * @param log	- Log sink.
+ * @param error	- If not null receive the errno of the last error or 0.
+ */
+unsigned long xformat_log_errors(struct xformat_log_s * log,int * error)
+{
+	if (error != 0)
+		*error = __atomic_load_n(&log->error,__ATOMIC_RELAXED);
+
+	return __atomic_load_n(&log->failed,__ATOMIC_RELAXED);
+}
+
+
+/**
+ * Write all the records and release the log sink, the producers must
+ * be already terminated.
+ *
+ * @param log	- Log sink.
+ */
+void xformat_log_close(struct xformat_log_s * log)
+{
+	__atomic_store_n(&log->stop,1,__ATOMIC_RELEASE);
+	pthread_join(log->thread,0);
+
+	free(log->slots);
+	free(log);
+}
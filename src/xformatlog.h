@@ -0,0 +1,57 @@
+/**
+ * @file        xformatlog.h
+ *
+ * @brief       Multi producer log sink for xformatc.
+ *
+ * @author      Mario Viara
+ *
+ * @copyright   Copyright Mario Viara 2014  - License Open Source (LGPL)
+ * This is a free software and is opened for education, research and commercial
+ * developments under license policy of following terms:
+ * - This is a free software and there is NO WARRANTY.
+ * - No restriction on use. You can use, modify and redistribute it for personal,
+ *   non-profit or commercial product UNDER YOUR RESPONSIBILITY.
+ * - Redistributions of source code must retain the above copyright notice.
+ *
+ * To contact the author send an email to mario_at_viara.eu*
+ */
+#ifndef XFORMATLOG_H
+#define XFORMATLOG_H
+#include "xformatc.h"
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Policy used when the ring is full
+ */
+#define XFORMAT_LOG_DROP	0	/* The record is lost and counted		*/
+#define XFORMAT_LOG_BLOCK	1	/* The producer wait for a free slot	*/
+
+
+/**
+ * Log sink, the structure is private to xformatlog.c
+ */
+struct xformat_log_s;
+
+
+struct xformat_log_s * xformat_log_open(int fd,unsigned slots,unsigned size,int policy);
+
+unsigned xformat_log(struct xformat_log_s * log,const char * fmt,...);
+
+unsigned xvformat_log(struct xformat_log_s * log,const char * fmt,va_list args);
+
+unsigned long xformat_log_overflow(struct xformat_log_s * log);
+
+unsigned long xformat_log_waits(struct xformat_log_s * log);
+
+unsigned long xformat_log_errors(struct xformat_log_s * log,int * error);
+
+void xformat_log_close(struct xformat_log_s * log);
+
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
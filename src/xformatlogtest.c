@@ -0,0 +1,290 @@
+/**
+ * @file        xformatlogtest.c
+ *
+ * @brief       Multi thread stress and throughput test for xformatlog.c
+ *
+ *
+ * @author      Mario Viara
+ *
+ * @version     1.00
+ *
+ * @copyright   Copyright Mario Viara 2014  - License Open Source (LGPL)
+ * This is a free software and is opened for education, research and commercial
+ * developments under license policy of following terms:
+ * - This is a free software and there is NO WARRANTY.
+ * - No restriction on use. You can use, modify and redistribute it for personal,
+ *   non-profit or commercial product UNDER YOUR RESPONSIBILITY.
+ * - Redistributions of source code must retain the above copyright notice.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include "xformatlog.h"
+
+#define MAX_THREADS	64
+
+static struct xformat_log_s * logSink;
+static pthread_mutex_t logMutex = PTHREAD_MUTEX_INITIALIZER;
+static int logFd;
+static long records;
+
+static const char payload[] = "the quick brown fox jump over the lazy dog";
+
+
+/**
+ * Producer using the log sink
+ */
+static void * producerLog(void * arg)
+{
+	int id = (int)(size_t)arg;
+	long i;
+
+	for (i = 0 ; i < records ; i++)
+	{
+		xformat_log(logSink,"T%02d %08lu %s %f\n",id,(unsigned long)i,payload,(double)i / 8.0);
+	}
+
+	return 0;
+}
+
+
+/**
+ * Producer serialized by a mutex, one write for each record
+ */
+static void * producerMutex(void * arg)
+{
+	int id = (int)(size_t)arg;
+	char buffer[128];
+	unsigned len;
+	long i;
+
+	for (i = 0 ; i < records ; i++)
+	{
+		pthread_mutex_lock(&logMutex);
+		len = xsnformat(buffer,sizeof(buffer),"T%02d %08lu %s %f\n",id,(unsigned long)i,payload,(double)i / 8.0);
+		if (write(logFd,buffer,len) != (ssize_t)len)
+		{
+			pthread_mutex_unlock(&logMutex);
+			break;
+		}
+		pthread_mutex_unlock(&logMutex);
+	}
+
+	return 0;
+}
+
+
+/**
+ * Check the records of each thread are in order, without gaps if lost
+ * records are not allowed.
+ *
+ * @return The number of records or -1 on error.
+ */
+static long checkOutput(FILE * file,int threads,int gaps)
+{
+	long last[MAX_THREADS];
+	char line[256];
+	unsigned long seq;
+	long count = 0;
+	int id;
+
+	for (id = 0 ; id < threads ; id++)
+	{
+		last[id] = -1;
+	}
+
+	rewind(file);
+
+	while (fgets(line,sizeof(line),file))
+	{
+		if (sscanf(line,"T%d %lu",&id,&seq) != 2 || id < 0 || id >= threads ||
+			(long)seq <= last[id] || (!gaps && (long)seq != last[id] + 1) ||
+			strstr(line,payload) == 0)
+		{
+			fprintf(stderr,"Invalid record %ld '%s'\n",count,line);
+			return -1;
+		}
+
+		last[id] = (long)seq;
+		count++;
+	}
+
+	return count;
+}
+
+
+static int testLog(const char * name,int threads,int policy,unsigned slots)
+{
+	pthread_t thread[MAX_THREADS];
+	struct timeval start,now;
+	unsigned long overflow = 0;
+	unsigned long waits = 0;
+	unsigned long errors = 0;
+	double elapsed;
+	FILE * file;
+	long count;
+	int i;
+
+	file = tmpfile();
+	if (file == 0)
+	{
+		perror("tmpfile");
+		return 1;
+	}
+
+	logFd = fileno(file);
+
+	printf("Starting test for %s ... ",name);
+	fflush(stdout);
+	gettimeofday(&start,0);
+
+	if (policy >= 0)
+	{
+		logSink = xformat_log_open(logFd,slots,128,policy);
+		if (logSink == 0)
+		{
+			fprintf(stderr,"xformat_log_open failed\n");
+			return 1;
+		}
+	}
+
+	for (i = 0 ; i < threads ; i++)
+	{
+		pthread_create(&thread[i],0,policy >= 0 ? producerLog : producerMutex,(void *)(size_t)i);
+	}
+
+	for (i = 0 ; i < threads ; i++)
+	{
+		pthread_join(thread[i],0);
+	}
+
+	if (policy >= 0)
+	{
+		overflow = xformat_log_overflow(logSink);
+		waits = xformat_log_waits(logSink);
+		errors = xformat_log_errors(logSink,0);
+		xformat_log_close(logSink);
+	}
+
+	gettimeofday(&now,0);
+	elapsed = ((double)now.tv_sec * 1000000.0 + now.tv_usec) - ((double)start.tv_sec * 1000000.0 + start.tv_usec);
+	elapsed /= 1000000.0;
+
+	count = checkOutput(file,threads,policy == XFORMAT_LOG_DROP);
+	fclose(file);
+
+	printf(" Elapsed %.3f second(s) %.0f records/s overflow %lu waits %lu\n",elapsed,(double)count / elapsed,overflow,waits);
+	fflush(stdout);
+
+	if (count < 0 || errors != 0 || (policy == XFORMAT_LOG_BLOCK && overflow != 0) ||
+		(policy == XFORMAT_LOG_DROP && waits != 0) || (policy == XFORMAT_LOG_DROP ?
+		(unsigned long)count + overflow != (unsigned long)threads * (unsigned long)records :
+		count != threads * records))
+	{
+		fprintf(stderr,"%s failed %ld records written overflow %lu\n",name,count,overflow);
+		return 1;
+	}
+
+	return 0;
+}
+
+
+/**
+ * Records written to an invalid file descriptor must be counted with
+ * the error, too large rings must be rejected.
+ */
+static int testErrors(void)
+{
+	struct timespec wait;
+	unsigned long errors = 0;
+	int error = 0;
+	int i;
+
+	printf("Starting test for errors ...");
+	fflush(stdout);
+
+	if (xformat_log_open(1,~0u,128,XFORMAT_LOG_BLOCK) != 0)
+	{
+		fprintf(stderr,"xformat_log_open too large ring failed\n");
+		return 1;
+	}
+
+	logSink = xformat_log_open(-1,16,128,XFORMAT_LOG_BLOCK);
+	if (logSink == 0)
+	{
+		fprintf(stderr,"xformat_log_open failed\n");
+		return 1;
+	}
+
+	for (i = 0 ; i < 10 ; i++)
+	{
+		xformat_log(logSink,"Record %d\n",i);
+	}
+
+	wait.tv_sec = 0;
+	wait.tv_nsec = 1000000;
+
+	for (i = 0 ; i < 5000 && errors < 10 ; i++)
+	{
+		nanosleep(&wait,0);
+		errors = xformat_log_errors(logSink,&error);
+	}
+
+	xformat_log_close(logSink);
+
+	printf(" errors %lu errno %d\n",errors,error);
+
+	if (errors != 10 || error != EBADF)
+	{
+		fprintf(stderr,"Log errors failed\n");
+		return 1;
+	}
+
+	return 0;
+}
+
+
+int main(int argc,char **argv)
+{
+	int threads = 8;
+
+	records = 100000;
+
+	if (argc > 1)
+		threads = atoi(argv[1]);
+	if (argc > 2)
+		records = atol(argv[2]);
+
+	if (threads < 1 || threads > MAX_THREADS || records < 1)
+	{
+		printf("usage: xformatlogtest [threads] [records]\n");
+		exit(1);
+	}
+
+	printf("Test log sink using %d threads %ld records\n",threads,records);
+
+	if (testLog("Mutex and write   ",threads,-1,0) ||
+		testLog("Log ring block    ",threads,XFORMAT_LOG_BLOCK,4096) ||
+		testLog("Log ring drop     ",threads,XFORMAT_LOG_DROP,4096) ||
+		testLog("Small ring block  ",threads,XFORMAT_LOG_BLOCK,16) ||
+		testLog("Small ring drop   ",threads,XFORMAT_LOG_DROP,16) ||
+		testErrors())
+	{
+		exit(1);
+	}
+
+	fprintf(stderr,"\nTest completed successfully\n");
+
+	return 0;
+}
@@ -0,0 +1,316 @@
+/**
+ * @file        xformatmtbench.c
+ *
+ * @brief       Multi thread scaling benchmark of xformatc and its sinks
+ *
+ * From 1 to N threads format the same records in private and shared
+ * destinations, the aggregate throughput and the percentiles of the
+ * latency of one call show the contention and the false sharing of the
+ * engine and of the sinks :
+ *
+ *   xformatmtbench [threads] [records]
+ *
+ * Some records are compared with the output of snprintf, built with
+ * XCFG_FORMAT_STATIC=static and without XCFG_FORMAT_TLS the errors
+ * show the data race on the shared parameters.
+ *
+ *
+ * @author      Mario Viara
+ *
+ * @version     1.00
+ *
+ * @copyright   Copyright Mario Viara 2014  - License Open Source (LGPL)
+ * This is a free software and is opened for education, research and commercial
+ * developments under license policy of following terms:
+ * - This is a free software and there is NO WARRANTY.
+ * - No restriction on use. You can use, modify and redistribute it for personal,
+ *   non-profit or commercial product UNDER YOUR RESPONSIBILITY.
+ * - Redistributions of source code must retain the above copyright notice.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "xformatlog.h"
+#include "xformatfd.h"
+
+#define MAX_THREADS		256
+
+/**
+ * Space of one thread in the packed buffer, less than a cache line
+ */
+#define PACKED_SIZE		16
+
+#define FMT				"T%02d %08ld %s %5u|%x\n"
+
+enum mode_e
+{
+	MODE_BUFFER,		/* Private buffer on the stack of the thread	*/
+	MODE_PACKED,		/* Private slice of one shared array			*/
+	MODE_CTX,			/* Private buffer and private context			*/
+	MODE_LOG,			/* Shared lock-free log ring					*/
+	MODE_FD,			/* Shared fd sink serialized by a mutex			*/
+	MODE_COUNT
+};
+
+static const char * const modeNames[MODE_COUNT] =
+{
+	"buffer","packed","ctx","log ring","fd+mutex"
+};
+
+
+/**
+ * State of one thread
+ */
+struct worker_s
+{
+	pthread_t	thread;
+	int			id;
+	int			mode;
+	unsigned	errors;
+	unsigned *	latency;
+};
+
+
+static const char payload[] = "the quick brown fox";
+static pthread_barrier_t barrier;
+static pthread_mutex_t fdMutex = PTHREAD_MUTEX_INITIALIZER;
+static struct xformat_log_s * logSink;
+static struct xformat_fd_s fdSink;
+static char packed[MAX_THREADS * PACKED_SIZE];
+static long records;
+static unsigned long totalErrors;
+
+
+static unsigned long long benchNow(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+}
+
+
+static void * worker(void * arg)
+{
+	struct worker_s * w = (struct worker_s *)arg;
+	struct xformat_ctx_s ctx;
+	unsigned long long start;
+	char buffer[128];
+	char ref[128];
+	char * out;
+	size_t size;
+	long i;
+
+	out = w->mode == MODE_PACKED ? packed + w->id * PACKED_SIZE : buffer;
+	size = w->mode == MODE_PACKED ? PACKED_SIZE : sizeof(buffer);
+
+	pthread_barrier_wait(&barrier);
+
+	for (i = 0 ; i < records ; i++)
+	{
+		start = benchNow();
+
+		switch (w->mode)
+		{
+			case MODE_CTX:
+				xsnformat_ctx(&ctx,out,size,FMT,w->id,i,payload,(unsigned)i & 0xffff,(unsigned)i);
+				break;
+
+			case MODE_LOG:
+				xformat_log(logSink,FMT,w->id,i,payload,(unsigned)i & 0xffff,(unsigned)i);
+				break;
+
+			case MODE_FD:
+				pthread_mutex_lock(&fdMutex);
+				xformat_fd(&fdSink,FMT,w->id,i,payload,(unsigned)i & 0xffff,(unsigned)i);
+				pthread_mutex_unlock(&fdMutex);
+				break;
+
+			default:
+				xsnformat(out,size,FMT,w->id,i,payload,(unsigned)i & 0xffff,(unsigned)i);
+				break;
+		}
+
+		w->latency[i] = (unsigned)(benchNow() - start);
+
+		/* Check the output of the private destinations */
+		if ((i & 63) == 0 && w->mode != MODE_LOG && w->mode != MODE_FD)
+		{
+			snprintf(ref,size,FMT,w->id,i,payload,(unsigned)i & 0xffff,(unsigned)i);
+			if (strcmp(out,ref))
+				w->errors++;
+		}
+	}
+
+	return 0;
+}
+
+
+static int compareUnsigned(const void * a,const void * b)
+{
+	unsigned x = *(const unsigned *)a;
+	unsigned y = *(const unsigned *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+
+/**
+ * Run one mode with a number of threads and print one line of results.
+ */
+static int benchRun(int mode,int threads,struct worker_s * workers,unsigned * all)
+{
+	unsigned long long start,elapsed;
+	unsigned errors = 0;
+	size_t n = (size_t)threads * (size_t)records;
+	int fd = -1;
+	char buf[65536];
+	int i;
+
+	if (mode == MODE_LOG || mode == MODE_FD)
+	{
+		fd = open("/dev/null",O_WRONLY);
+		if (fd < 0)
+		{
+			perror("/dev/null");
+			return 1;
+		}
+	}
+
+	if (mode == MODE_LOG)
+	{
+		logSink = xformat_log_open(fd,4096,128,XFORMAT_LOG_BLOCK);
+		if (logSink == 0)
+		{
+			fprintf(stderr,"xformat_log_open failed\n");
+			return 1;
+		}
+	}
+
+	if (mode == MODE_FD)
+		xformat_fd_init(&fdSink,fd,buf,sizeof(buf),XFORMAT_FD_FULL,0);
+
+	pthread_barrier_init(&barrier,0,(unsigned)threads + 1);
+
+	for (i = 0 ; i < threads ; i++)
+	{
+		workers[i].id = i;
+		workers[i].mode = mode;
+		workers[i].errors = 0;
+		workers[i].latency = all + (size_t)i * (size_t)records;
+		pthread_create(&workers[i].thread,0,worker,&workers[i]);
+	}
+
+	pthread_barrier_wait(&barrier);
+	start = benchNow();
+
+	for (i = 0 ; i < threads ; i++)
+	{
+		pthread_join(workers[i].thread,0);
+		errors += workers[i].errors;
+	}
+
+	elapsed = benchNow() - start;
+	pthread_barrier_destroy(&barrier);
+
+	if (mode == MODE_LOG)
+		xformat_log_close(logSink);
+	if (mode == MODE_FD)
+		xformat_fd_flush(&fdSink);
+	if (fd >= 0)
+		close(fd);
+
+	totalErrors += errors;
+	qsort(all,n,sizeof(unsigned),compareUnsigned);
+
+	printf("%-9s %7d %10.2f %10.2f %8u %8u %8u %8u %7u\n",modeNames[mode],threads,
+		(double)n * 1000.0 / (double)elapsed,
+		(double)n * 1000.0 / (double)elapsed / threads,
+		all[n / 2],all[n * 90 / 100],all[n * 99 / 100],all[n - 1 - n / 1000],errors);
+	fflush(stdout);
+
+	return 0;
+}
+
+
+int main(int argc,char **argv)
+{
+	struct worker_s * workers;
+	unsigned * all;
+	long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+	int threads = ncpu > 0 ? (int)ncpu : 4;
+	int mode,t;
+
+	records = 200000;
+
+	if (argc > 1)
+		threads = atoi(argv[1]);
+	if (argc > 2)
+		records = atol(argv[2]);
+
+	if (threads < 1 || threads > MAX_THREADS || records < 1)
+	{
+		printf("usage: xformatmtbench [threads <= %d] [records]\n",MAX_THREADS);
+		exit(1);
+	}
+
+	workers = (struct worker_s *)malloc(sizeof(struct worker_s) * (size_t)threads);
+	all = (unsigned *)malloc(sizeof(unsigned) * (size_t)threads * (size_t)records);
+	if (workers == 0 || all == 0)
+	{
+		fprintf(stderr,"Out of memory\n");
+		exit(1);
+	}
+
+	printf("Scaling of xformatc from 1 to %d threads, %ld records for each thread\n\n",threads,records);
+	printf("%-9s %7s %10s %10s %8s %8s %8s %8s %7s\n","mode","threads","Mrec/s","Mrec/s/th","p50 ns","p90 ns","p99 ns","p999 ns","errors");
+
+	for (mode = 0 ; mode < MODE_COUNT ; mode++)
+	{
+		for (t = 1 ; ; t = t * 2 < threads ? t * 2 : threads)
+		{
+			if (benchRun(mode,t,workers,all))
+				exit(1);
+			if (t == threads)
+				break;
+		}
+	}
+
+#if XCFG_FORMAT_STATS
+	{
+		struct xformat_stats_s stats;
+		int c;
+
+		xformat_stats(&stats);
+		printf("\nStats calls %lu bytes %lu writes %lu padding %lu truncations %lu\n",
+			stats.calls,stats.bytes,stats.writes,stats.padding,stats.truncations);
+		for (c = 'A' ; c <= 'z' ; c++)
+		{
+			if (stats.conv[XFORMAT_STATS_INDEX(c)])
+				printf("  %%%c %lu\n",c,stats.conv[XFORMAT_STATS_INDEX(c)]);
+		}
+	}
+#endif
+
+	free(all);
+	free(workers);
+
+	if (totalErrors)
+	{
+		fprintf(stderr,"\n%lu records wrong\n",totalErrors);
+		return 1;
+	}
+
+	return 0;
+}
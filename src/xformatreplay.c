@@ -0,0 +1,324 @@
+/**
+ * @file        xformatreplay.c
+ *
+ * @brief       Replay a corpus of formats through xformatc and vsnprintf
+ *
+ * The records of the corpus are converted in C by xformatcorpus and
+ * included from xformatreplay.inc. Each record is timed alone, then all
+ * the records are replayed mixed in random order, each one as many
+ * times as its weight, to measure the throughput on the real traffic :
+ *
+ *   xformatreplay [-json] [-uniform] [iterations] [passes]
+ *
+ * iterations is the number of calls of each record timed alone, passes
+ * the number of times the mix is replayed, -uniform give the same
+ * weight to all the records.
+ *
+ *
+ * @author      Mario Viara
+ *
+ * @version     1.00
+ *
+ * @copyright   Copyright Mario Viara 2014  - License Open Source (LGPL)
+ * This is a free software and is opened for education, research and commercial
+ * developments under license policy of following terms:
+ * - This is a free software and there is NO WARRANTY.
+ * - No restriction on use. You can use, modify and redistribute it for personal,
+ *   non-profit or commercial product UNDER YOUR RESPONSIBILITY.
+ * - Redistributions of source code must retain the above copyright notice.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "xformatc.h"
+
+#define REPLAY_SIZE		1024
+#define REPLAY_REPEAT	5
+
+
+typedef int (*format_t)(char * buf,size_t size,const char * fmt,...);
+
+/**
+ * One record of the corpus, run calls the format function once with
+ * the arguments of the record and return the number of chars.
+ */
+struct record_s
+{
+	const char *	fmt;
+	unsigned long	weight;
+	int				(*run)(format_t format,char * buf);
+};
+
+#include "xformatreplay.inc"
+
+#define NUM_RECORDS		(sizeof(records) / sizeof(records[0]))
+
+/**
+ * Result of one record
+ */
+struct result_s
+{
+	double	xformat;
+	double	system;
+	int		match;
+};
+
+
+static int xformatFormat(char * buf,size_t size,const char * fmt,...)
+{
+	va_list list;
+	int count;
+
+	va_start(list,fmt);
+	count = (int)xvsnformat(buf,size,fmt,list);
+	va_end(list);
+
+	return count;
+}
+
+
+static int systemFormat(char * buf,size_t size,const char * fmt,...)
+{
+	va_list list;
+	int count;
+
+	va_start(list,fmt);
+	count = vsnprintf(buf,size,fmt,list);
+	va_end(list);
+
+	return count;
+}
+
+
+/**
+ * Monotonic time in ns
+ */
+static double replayNow(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+
+	return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+
+/**
+ * Minimum ns for one call of one record in a number of repetitions.
+ */
+static double timeRecord(const struct record_s * r,format_t format,long iterations)
+{
+	char buf[REPLAY_SIZE];
+	double start,ns,min = 0;
+	long i;
+	int j;
+
+	for (j = 0 ; j <= REPLAY_REPEAT ; j++)
+	{
+		start = replayNow();
+		for (i = 0 ; i < iterations ; i++)
+		{
+			(*r->run)(format,buf);
+		}
+		ns = (replayNow() - start) / (double)iterations;
+
+		/* The first repetition warm up caches and branch predictors */
+		if (j == 1 || (j > 1 && ns < min))
+			min = ns;
+	}
+
+	return min;
+}
+
+
+/**
+ * Replay the mix and return the total ns, chars is the total output.
+ */
+static double timeMix(const unsigned * mix,unsigned long n,format_t format,long passes,double * chars)
+{
+	char buf[REPLAY_SIZE];
+	double start,sum = 0;
+	unsigned long i;
+	long p;
+
+	start = replayNow();
+	for (p = 0 ; p < passes ; p++)
+	{
+		for (i = 0 ; i < n ; i++)
+		{
+			sum += (*records[mix[i]].run)(format,buf);
+		}
+	}
+
+	*chars = sum;
+
+	return replayNow() - start;
+}
+
+
+/**
+ * Print a format as the content of a JSON or C string
+ */
+static void printEscaped(const char * s)
+{
+	for ( ; *s ; s++)
+	{
+		switch (*s)
+		{
+			case '\n':
+				printf("\\n");
+				break;
+			case '\t':
+				printf("\\t");
+				break;
+			case '"':
+			case '\\':
+				printf("\\%c",*s);
+				break;
+			default:
+				if ((unsigned char)*s < ' ')
+					printf("\\u%04x",(unsigned)*s);
+				else
+					putchar(*s);
+				break;
+		}
+	}
+}
+
+
+int main(int argc,char **argv)
+{
+	static struct result_s results[NUM_RECORDS];
+	char buf1[REPLAY_SIZE];
+	char buf2[REPLAY_SIZE];
+	double xtime,stime,xchars,schars,total = 0,share;
+	unsigned long n = 0,seed = 12345,k;
+	unsigned long weight;
+	unsigned * mix;
+	unsigned i,t;
+	long iterations = 100000;
+	long passes = 0;
+	int uniform = 0;
+	int json = 0;
+	int arg = 1;
+
+	for ( ; argc > arg && argv[arg][0] == '-' ; arg++)
+	{
+		if (strcmp(argv[arg],"-json") == 0)
+			json = 1;
+		else if (strcmp(argv[arg],"-uniform") == 0)
+			uniform = 1;
+		else
+			break;
+	}
+
+	if (argc > arg)
+		iterations = atol(argv[arg++]);
+	if (argc > arg)
+		passes = atol(argv[arg++]);
+
+	if (iterations < 1 || passes < 0 || argc > arg)
+	{
+		printf("usage: xformatreplay [-json] [-uniform] [iterations] [passes]\n");
+		exit(1);
+	}
+
+	/* Each record is in the mix as many times as its weight */
+	for (i = 0 ; i < NUM_RECORDS ; i++)
+	{
+		n += uniform ? 1 : records[i].weight;
+	}
+
+	mix = (unsigned *)malloc(sizeof(unsigned) * (n ? n : 1));
+	if (mix == 0)
+	{
+		fprintf(stderr,"Out of memory\n");
+		exit(1);
+	}
+
+	for (i = 0, k = 0 ; i < NUM_RECORDS ; i++)
+	{
+		for (weight = uniform ? 1 : records[i].weight ; weight > 0 ; weight--)
+		{
+			mix[k++] = i;
+		}
+	}
+
+	/* Fisher-Yates with a fixed seed, the same order for each run */
+	for (k = n ; k > 1 ; k--)
+	{
+		seed = seed * 1103515245UL + 12345UL;
+		t = mix[k - 1];
+		i = (unsigned)((seed >> 8) % k);
+		mix[k - 1] = mix[i];
+		mix[i] = t;
+	}
+
+	/* About the same number of calls of the records timed alone */
+	if (passes == 0)
+		passes = n ? (long)(iterations * (long)NUM_RECORDS / (long)n) + 1 : 0;
+
+	for (i = 0 ; i < NUM_RECORDS ; i++)
+	{
+		(*records[i].run)(xformatFormat,buf1);
+		(*records[i].run)(systemFormat,buf2);
+		results[i].match = strcmp(buf1,buf2) == 0;
+		results[i].xformat = timeRecord(&records[i],xformatFormat,iterations);
+		results[i].system = timeRecord(&records[i],systemFormat,iterations);
+		total += results[i].xformat * (double)(uniform ? 1 : records[i].weight);
+	}
+
+	xtime = n ? timeMix(mix,n,xformatFormat,passes,&xchars) : 0;
+	stime = n ? timeMix(mix,n,systemFormat,passes,&schars) : 0;
+
+	if (json)
+	{
+		printf("{\n  \"records\": %u,\n  \"iterations\": %ld,\n  \"passes\": %ld,\n  \"formats\": [\n",(unsigned)NUM_RECORDS,iterations,passes);
+		for (i = 0 ; i < NUM_RECORDS ; i++)
+		{
+			printf("    {\"format\": \"");
+			printEscaped(records[i].fmt);
+			printf("\", \"weight\": %lu, \"xformatc_ns\": %.2f, \"vsnprintf_ns\": %.2f, \"speedup\": %.3f, \"match\": %s}%s\n",
+				uniform ? 1 : records[i].weight,results[i].xformat,results[i].system,results[i].system / results[i].xformat,
+				results[i].match ? "true" : "false",i + 1 < NUM_RECORDS ? "," : "");
+		}
+		printf("  ]");
+		if (n)
+			printf(",\n  \"mix\": {\"calls\": %.0f, \"xformatc_mcalls_s\": %.3f, \"xformatc_mb_s\": %.1f, \"vsnprintf_mcalls_s\": %.3f, \"vsnprintf_mb_s\": %.1f, \"speedup\": %.3f}",
+				(double)n * (double)passes,(double)n * (double)passes * 1000.0 / xtime,xchars * 1000.0 / xtime,
+				(double)n * (double)passes * 1000.0 / stime,schars * 1000.0 / stime,stime / xtime);
+		printf("\n}\n");
+	}
+	else
+	{
+		printf("Replay of %u records, %ld iterations each, mix of %lu calls x %ld\n\n",(unsigned)NUM_RECORDS,iterations,n,passes);
+		printf("%8s %10s %10s %8s %7s  %s\n","weight","xformatc","vsnprintf","speedup","share","format");
+		for (i = 0 ; i < NUM_RECORDS ; i++)
+		{
+			weight = uniform ? 1 : records[i].weight;
+			share = total > 0 ? results[i].xformat * (double)weight * 100.0 / total : 0;
+			printf("%8lu %7.1f ns %7.1f ns %7.2fx %6.1f%%  %s",weight,results[i].xformat,results[i].system,
+				results[i].system / results[i].xformat,share,results[i].match ? "" : "(output differ) ");
+			printEscaped(records[i].fmt);
+			printf("\n");
+		}
+
+		if (n)
+		{
+			printf("\nMix xformatc  %8.3f Mcalls/s %8.1f MB/s\n",(double)n * (double)passes * 1000.0 / xtime,xchars * 1000.0 / xtime);
+			printf("Mix vsnprintf %8.3f Mcalls/s %8.1f MB/s\n",(double)n * (double)passes * 1000.0 / stime,schars * 1000.0 / stime);
+			printf("Mix speedup   %8.2fx\n",stime / xtime);
+		}
+	}
+
+	free(mix);
+
+	return 0;
+}
@@ -44,6 +44,52 @@ static int myVsprintf(char *buf,const char *fmt,va_list args)
     return result;
 }
 
+static void myWrite(void *arg,const char *p,size_t n)
+{
+    char ** s = (char **)arg;
+    memcpy(*s,p,n);
+    *s += n;
+}
+
+static int myVsprintfWrite(char *buf,const char *fmt,va_list args)
+{
+    int result = xvformat_write(myWrite,(void *)&buf,fmt,args);
+    *buf = 0;
+    return result;
+}
+
+static void myCount(void *arg,char c)
+{
+    (void)c;
+    (*(int *)arg)++;
+}
+
+static int myVcount(char *buf,const char *fmt,va_list args)
+{
+    int count = 0;
+
+    (void)buf;
+    xvformat(myCount,(void *)&count,fmt,args);
+    return count;
+}
+
+static int myVmeasure(char *buf,const char *fmt,va_list args)
+{
+    (void)buf;
+    return (int)xvformat_measure(fmt,args);
+}
+
+
+static int myVsnprintf(char *buf,const char *fmt,va_list args)
+{
+    return xvsnformat(buf,1024,fmt,args);
+}
+
+static int sysVsnprintf(char *buf,const char *fmt,va_list args)
+{
+    return vsnprintf(buf,1024,fmt,args);
+}
+
 
 static void testFormat(int (*format)(char *buffer,const char *format,va_list arg),const char * fmt,...)
 {
@@ -136,6 +182,237 @@ static void testspeed(const char * name,long count,int (*format)(char *buffer,co
 	fflush(stdout);
 }
 
+#if XCFG_FORMAT_FLOAT && XCFG_FORMAT_FLOAT_EXACT
+/**
+ * Typical values read from sensors
+ */
+static const double sensors[] =
+{
+	23.57,1013.25,-0.00123,6.02e23,1e-12,0.1,3.3,298.15,
+	-40.0,1.0 / 3.0,9.80665,4.2e-7,12345.678,0.0,-273.15,65535.0
+};
+
+static void testsensor(const char * name,long count,int (*format)(char *buffer,const char * fmt,va_list args),const char * fmt)
+{
+	long i;
+	unsigned j;
+	struct timeval start,now;
+	double elapsed;
+
+	printf("Starting test for %s ... ",name);
+	fflush(stdout);
+	gettimeofday(&start,0);
+
+	for (i = 0 ; i < count ; i++)
+	{
+		for (j = 0 ; j < sizeof(sensors) / sizeof(sensors[0]) ; j++)
+		{
+			testFormat(format,fmt,sensors[j]);
+		}
+	}
+
+	gettimeofday(&now,0);
+	elapsed = ((double)now.tv_sec * 1000000.0 + now.tv_usec) - ((double)start.tv_sec * 1000000.0 + start.tv_usec);
+	elapsed /= 1000000.0;
+
+	printf(" Elapsed %.3f second(s)\n",elapsed);
+	fflush(stdout);
+}
+#endif
+
+#if XCFG_FORMAT_BATCH
+#define BATCH_ROWS	256
+
+/**
+ * Metrics exported as CSV rows, one array for each column
+ */
+static int batchId[BATCH_ROWS];
+static long batchCount[BATCH_ROWS];
+static const char * batchName[BATCH_ROWS];
+#if XCFG_FORMAT_FLOAT
+static double batchValue[BATCH_ROWS];
+#define BATCH_FORMAT	"%d,%ld,%s,%.3f\n"
+#else
+#define BATCH_FORMAT	"%d,%ld,%s\n"
+#endif
+
+static void testbatch(const char * name,long count,int batch)
+{
+	static char buffer[BATCH_ROWS * 64];
+	const void * columns[4];
+	struct timeval start,now;
+	double elapsed;
+	char * s;
+	long i;
+	int j;
+
+	for (j = 0 ; j < BATCH_ROWS ; j++)
+	{
+		batchId[j] = j;
+		batchCount[j] = (long)j * 7919L - 100000L;
+		batchName[j] = j & 1 ? "pressure" : "temperature";
+#if XCFG_FORMAT_FLOAT
+		batchValue[j] = (double)j / 7.0;
+#endif
+	}
+
+	columns[0] = batchId;
+	columns[1] = batchCount;
+	columns[2] = batchName;
+#if XCFG_FORMAT_FLOAT
+	columns[3] = batchValue;
+#endif
+
+	printf("Starting test for %s ... ",name);
+	fflush(stdout);
+	gettimeofday(&start,0);
+
+	for (i = 0 ; i < count / 16 ; i++)
+	{
+		s = buffer;
+		if (batch)
+			xformat_batch(BATCH_FORMAT,columns,BATCH_ROWS,myWrite,(void *)&s);
+		else
+		{
+			for (j = 0 ; j < BATCH_ROWS ; j++)
+			{
+#if XCFG_FORMAT_FLOAT
+				xformat_write(myWrite,(void *)&s,BATCH_FORMAT,batchId[j],batchCount[j],batchName[j],batchValue[j]);
+#else
+				xformat_write(myWrite,(void *)&s,BATCH_FORMAT,batchId[j],batchCount[j],batchName[j]);
+#endif
+			}
+		}
+	}
+
+	gettimeofday(&now,0);
+	elapsed = ((double)now.tv_sec * 1000000.0 + now.tv_usec) - ((double)start.tv_sec * 1000000.0 + start.tv_usec);
+	elapsed /= 1000000.0;
+
+	printf(" Elapsed %.3f second(s)\n",elapsed);
+	fflush(stdout);
+}
+#endif
+
+#if XCFG_FORMAT_IOV
+/**
+ * Request log with a large payload, copied in one buffer or referenced
+ * by the runs for writev.
+ */
+static void testiov(const char * name,long count,int iov)
+{
+	static char payload[4096];
+	static char buffer[sizeof(payload) + 256];
+	struct xformat_iovec_s runs[16];
+	struct xformat_iov_s v;
+	char arena[128];
+	struct timeval start,now;
+	double elapsed;
+	char * s;
+	long i;
+
+	memset(payload,'p',sizeof(payload) - 1);
+
+	printf("Starting test for %s ... ",name);
+	fflush(stdout);
+	gettimeofday(&start,0);
+
+	for (i = 0 ; i < count ; i++)
+	{
+		if (iov)
+		{
+			xformat_iov_init(&v,runs,16,arena,sizeof(arena));
+			xformat_iov(&v,"GET /index %d %s %lu\n",200,payload,(unsigned long)i);
+		}
+		else
+		{
+			s = buffer;
+			xformat_write(myWrite,(void *)&s,"GET /index %d %s %lu\n",200,payload,(unsigned long)i);
+		}
+	}
+
+	gettimeofday(&now,0);
+	elapsed = ((double)now.tv_sec * 1000000.0 + now.tv_usec) - ((double)start.tv_sec * 1000000.0 + start.tv_usec);
+	elapsed /= 1000000.0;
+
+	printf(" Elapsed %.3f second(s)\n",elapsed);
+	fflush(stdout);
+}
+#endif
+
+#if XCFG_FORMAT_ARENA
+static void * arenaAlloc(void *arg,void *ptr,size_t size)
+{
+	(void)arg;
+
+	if (size == 0)
+	{
+		free(ptr);
+		return 0;
+	}
+
+	return malloc(size);
+}
+
+
+/**
+ * Short strings of one request allocated one at time with malloc or in
+ * one arena reset at the end of the request.
+ */
+static void testarena(const char * name,long count,int arena)
+{
+	struct xformat_arena_s a;
+	char * strings[16];
+	char buffer[128];
+	char first[256];
+	struct timeval start,now;
+	double elapsed;
+	unsigned n;
+	long i;
+	int j;
+
+	xformat_arena_init(&a,first,sizeof(first),arenaAlloc,0);
+
+	printf("Starting test for %s ... ",name);
+	fflush(stdout);
+	gettimeofday(&start,0);
+
+	for (i = 0 ; i < count ; i++)
+	{
+		for (j = 0 ; j < 16 ; j++)
+		{
+			if (arena)
+				strings[j] = xaformat(&a,"key-%d-%lu=%s",j,(unsigned long)i,"value").str;
+			else
+			{
+				n = xsnformat(buffer,sizeof(buffer),"key-%d-%lu=%s",j,(unsigned long)i,"value");
+				strings[j] = (char *)malloc(n + 1);
+				memcpy(strings[j],buffer,n + 1);
+			}
+		}
+
+		if (arena)
+			xformat_arena_reset(&a);
+		else
+		{
+			for (j = 0 ; j < 16 ; j++)
+			{
+				free(strings[j]);
+			}
+		}
+	}
+
+	gettimeofday(&now,0);
+	elapsed = ((double)now.tv_sec * 1000000.0 + now.tv_usec) - ((double)start.tv_sec * 1000000.0 + start.tv_usec);
+	elapsed /= 1000000.0;
+
+	xformat_arena_free(&a);
+
+	printf(" Elapsed %.3f second(s)\n",elapsed);
+	fflush(stdout);
+}
+#endif
+
 int main(int argc,char **argv)
 {
 	long count = 0;
@@ -151,8 +428,35 @@ int main(int argc,char **argv)
 		count = atol(argv[1]);
 	
 		printf("Test speed for xprintfc using %lu cycle\n",count);
-		testspeed("System   ",count,vsprintf);
-		testspeed("xformatc ",count,myVsprintf);
+		testspeed("System   sprintf ",count,vsprintf);
+		testspeed("xformatc char    ",count,myVsprintf);
+		testspeed("xformatc write   ",count,myVsprintfWrite);
+		testspeed("System   snprintf",count,sysVsnprintf);
+		testspeed("xformatc snformat",count,myVsnprintf);
+		testspeed("xformatc count   ",count,myVcount);
+		testspeed("xformatc measure ",count,myVmeasure);
+#if XCFG_FORMAT_FLOAT && XCFG_FORMAT_FLOAT_EXACT
+		testsensor("System   %e      ",count,sysVsnprintf,"%.6e");
+		testsensor("xformatc %e      ",count,myVsnprintf,"%.6e");
+		testsensor("System   %g      ",count,sysVsnprintf,"%.6g");
+		testsensor("xformatc %g      ",count,myVsnprintf,"%.6g");
+#if XCFG_FORMAT_FLOAT_SHORTEST
+		testsensor("System   %.17g   ",count,sysVsnprintf,"%.17g");
+		testsensor("xformatc shortest",count,myVsnprintf,"%g");
+#endif
+#endif
+#if XCFG_FORMAT_BATCH
+		testbatch("xformatc per row  ",count,0);
+		testbatch("xformatc batch    ",count,1);
+#endif
+#if XCFG_FORMAT_IOV
+		testiov("xformatc copy 4K  ",count,0);
+		testiov("xformatc iov 4K   ",count,1);
+#endif
+#if XCFG_FORMAT_ARENA
+		testarena("xformatc malloc   ",count,0);
+		testarena("xformatc arena    ",count,1);
+#endif
 	}
 	
 	return 0;
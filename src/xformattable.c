@@ -100,7 +100,13 @@ void make(void)
             case    'p':
             case    'P':
             case    'f':
+            case    'e':
+            case    'E':
+            case    'g':
+            case    'G':
             case    'B':
+            case    'v':
+            case    'V':
                 cl = CH_TYPE;
                 break;
 
@@ -115,7 +121,7 @@ void make(void)
             table[i] = table[i] | (states[i] << 4);
     }
 
-    printf("static const unsigned char formatStates[] =\n{\n");
+    printf("#define XFORMAT_STATES \\\n");
 
     for (i = 0;  i < N ; i++)
     {
@@ -125,9 +131,9 @@ void make(void)
         if (i + 1 < N)
             printf(",");
         if ((i+1) % 8 == 0)
-            printf("\n");
+            printf(" \\\n");
     }
-    printf("\n};\n\n");
+    printf("\n\n");
 }
 
 
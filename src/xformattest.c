@@ -25,6 +25,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <math.h>
+#include <float.h>
 
 #include "xformatc.h"
 
@@ -41,11 +42,36 @@ static void myPrintf(char *buf,const char *fmt,va_list args)
     *buf = 0;
 }
 
+static void myWrite(void *arg,const char *p,size_t n)
+{
+    char ** s = (char **)arg;
+    memcpy(*s,p,n);
+    *s += n;
+}
+
+static void myWritePrintf(char *buf,const char *fmt,va_list args)
+{
+    xvformat_write(myWrite,(void *)&buf,fmt,args);
+    *buf = 0;
+}
+
+
+/**
+ * One context reused by all the tests
+ */
+static struct xformat_ctx_s testCtx;
+
 
 static void testFormat(const char * fmt,...)
 {
     char buf1[1024];
     char buf2[1024];
+    char buf3[1024];
+    char buf4[1024];
+    char buf5[1024];
+    char * p;
+    struct xformat_spec_s prog[16];
+    unsigned count;
 
     va_list list;
 #if  XCFG_FORMAT_VA_COPY
@@ -76,6 +102,116 @@ static void testFormat(const char * fmt,...)
     va_end(list);
 #endif
 
+#if  XCFG_FORMAT_VA_COPY
+    va_copy(list,args);
+#else
+    va_end(list);
+    va_start(list,fmt);
+#endif
+
+    myWritePrintf(buf3,fmt,list);
+
+#if  XCFG_FORMAT_VA_COPY
+    va_end(list);
+#endif
+
+    if (strcmp(buf1,buf3))
+    {
+        fprintf(stderr,"XFormat : '%s'\nWrite   : '%s'\nFormat  : '%s' failed\n",
+               buf1,buf3,fmt);
+        exit(1);
+    }
+
+#if  XCFG_FORMAT_VA_COPY
+    va_copy(list,args);
+#else
+    va_end(list);
+    va_start(list,fmt);
+#endif
+
+    count = xvsnformat(buf4,sizeof(buf4),fmt,list);
+
+#if  XCFG_FORMAT_VA_COPY
+    va_end(list);
+#endif
+
+    if (strcmp(buf1,buf4) || count != strlen(buf1))
+    {
+        fprintf(stderr,"XFormat : '%s'\nMemory  : '%s' (%u)\nFormat  : '%s' failed\n",
+               buf1,buf4,count,fmt);
+        exit(1);
+    }
+
+    if (xformat_compile(fmt,prog,sizeof(prog)/sizeof(prog[0])) == 0)
+    {
+        fprintf(stderr,"Format  : '%s' compile failed\n",fmt);
+        exit(1);
+    }
+
+#if  XCFG_FORMAT_VA_COPY
+    va_copy(list,args);
+#else
+    va_end(list);
+    va_start(list,fmt);
+#endif
+
+    p = buf5;
+    count = xvformat_compiled(prog,myWrite,(void *)&p,list);
+    *p = 0;
+
+#if  XCFG_FORMAT_VA_COPY
+    va_end(list);
+#endif
+
+    if (strcmp(buf1,buf5) || count != strlen(buf1))
+    {
+        fprintf(stderr,"XFormat : '%s'\nCompiled: '%s' (%u)\nFormat  : '%s' failed\n",
+               buf1,buf5,count,fmt);
+        exit(1);
+    }
+
+
+#if  XCFG_FORMAT_VA_COPY
+    va_copy(list,args);
+#else
+    va_end(list);
+    va_start(list,fmt);
+#endif
+
+    count = xvsnformat_ctx(&testCtx,buf5,sizeof(buf5),fmt,list);
+
+#if  XCFG_FORMAT_VA_COPY
+    va_end(list);
+#endif
+
+    if (strcmp(buf1,buf5) || count != strlen(buf1))
+    {
+        fprintf(stderr,"XFormat : '%s'\nContext : '%s' (%u)\nFormat  : '%s' failed\n",
+               buf1,buf5,count,fmt);
+        exit(1);
+    }
+
+
+#if  XCFG_FORMAT_VA_COPY
+    va_copy(list,args);
+#else
+    va_end(list);
+    va_start(list,fmt);
+#endif
+
+    count = xvformat_measure(fmt,list);
+
+#if  XCFG_FORMAT_VA_COPY
+    va_end(list);
+#endif
+
+    if (count != strlen(buf1))
+    {
+        fprintf(stderr,"XFormat : '%s' (%u)\nMeasure : %u\nFormat  : '%s' failed\n",
+               buf1,(unsigned)strlen(buf1),count,fmt);
+        exit(1);
+    }
+
 
     if (*fmt != '*' && strcmp(buf1,buf2))
     {
@@ -98,6 +234,212 @@ static void testFormat(const char * fmt,...)
 
 }
 
+static void testTruncate(size_t size,const char * fmt,...)
+{
+    char buf1[64];
+    char buf2[64];
+    unsigned count;
+    int result;
+
+    va_list list;
+
+    memset(buf1,'#',sizeof(buf1));
+    memset(buf2,'#',sizeof(buf2));
+
+    va_start(list,fmt);
+    count = xvsnformat(buf1,size,fmt,list);
+    va_end(list);
+
+    va_start(list,fmt);
+    result = vsnprintf(buf2,size,fmt,list);
+    va_end(list);
+
+    if (memcmp(buf1,buf2,sizeof(buf1)) || count != (unsigned)result)
+    {
+        fprintf(stderr,"XFormat  : '%.*s' (%u)\nvsnprintf: '%.*s' (%d)\nFormat   : '%s' size %u failed\n",
+               (int)size,buf1,count,(int)size,buf2,result,fmt,(unsigned)size);
+        exit(1);
+    }
+    else
+    {
+        printf("'%s' (%u)\n",size ? buf1 : "",count);
+    }
+}
+
+#if XCFG_FORMAT_DEFER
+/**
+ * Storage for the deferred records, aligned as a double
+ */
+static double deferStorage[32];
+static struct xformat_ring_s deferRing;
+
+/**
+ * Defer one format, replay it and compare with the direct conversion.
+ */
+static void testDefer(const char * fmt,...)
+{
+    char buf1[1024];
+    char buf2[1024];
+    char * s = buf2;
+    unsigned count;
+    va_list list;
+
+    va_start(list,fmt);
+    xvsnformat(buf1,sizeof(buf1),fmt,list);
+    va_end(list);
+
+    va_start(list,fmt);
+    count = xvformat_defer(&deferRing,fmt,list);
+    va_end(list);
+
+    if (count == 0 || xformat_replay(&deferRing,myWrite,(void *)&s) != 1)
+    {
+        fprintf(stderr,"Format  : '%s' defer failed\n",fmt);
+        exit(1);
+    }
+
+    *s = 0;
+
+    if (strcmp(buf1,buf2))
+    {
+        fprintf(stderr,"XFormat : '%s'\nReplay  : '%s'\nFormat  : '%s' failed\n",buf1,buf2,fmt);
+        exit(1);
+    }
+    else
+    {
+        printf("'%s' (%u)\n",buf2,count);
+    }
+}
+#endif
+
+#if XCFG_FORMAT_LONGLONG
+/**
+ * Check hex against vsnprintf and binary against a reference for
+ * values of any length, the digits are converted in chunks.
+ */
+static void testRadix(void)
+{
+    unsigned long long seed = 12345;
+    unsigned long long val;
+    char buf1[256];
+    char buf2[256];
+    char bin[65];
+    char * p;
+    int i,j,k,n,len;
+
+    for (i = 0 ; i < 4000 ; i++)
+    {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        val = seed >> (i % 64);
+        n = i % 65;
+
+        xsnformat(buf1,sizeof(buf1),"%llx %llX %#llx %.*llx %lx %X %.*x %p",
+                  val,val,val,n,val,(unsigned long)val,(unsigned)val,n % 20 + 1,(unsigned)val,(void *)(size_t)val);
+        snprintf(buf2,sizeof(buf2),"%llx %llX %#llx %.*llx %lx %X %.*x ->%0*llx",
+                 val,val,val,n,val,(unsigned long)val,(unsigned)val,n % 20 + 1,(unsigned)val,(int)sizeof(void *) * 2,(unsigned long long)(size_t)val);
+
+        if (strcmp(buf1,buf2))
+        {
+            fprintf(stderr,"XFormat : '%s'\nsnprintf: '%s'\nHex failed\n",buf1,buf2);
+            exit(1);
+        }
+
+        for (j = 0 ; j < 64 ; j++)
+        {
+            bin[j] = (char)('0' + ((val >> (63 - j)) & 1));
+        }
+        bin[64] = 0;
+
+        for (j = 0 ; j < 63 && bin[j] == '0' ; j++)
+        {
+        }
+
+        for (k = 56 ; k < 63 && bin[k] == '0' ; k++)
+        {
+        }
+
+        xsnformat(buf1,sizeof(buf1),"%llb %.*llb %b",val,n,val,(unsigned)val & 0xFF);
+
+        p = buf2 + sprintf(buf2,"%s ",bin + j);
+        for (len = 64 - j ; len < n ; len++)
+        {
+            *p++ = '0';
+        }
+        sprintf(p,"%s %s",bin + j,bin + k);
+
+        if (strcmp(buf1,buf2))
+        {
+            fprintf(stderr,"XFormat : '%s'\nExpected: '%s'\nBinary failed\n",buf1,buf2);
+            exit(1);
+        }
+    }
+
+    printf("Radix test completed\n");
+}
+#endif
+
+#if XCFG_FORMAT_FLOAT_SHORTEST && XCFG_FORMAT_FLOAT_PREC == 0
+/**
+ * Check that %e / %g read back as the same value, that no shorter
+ * representation exist and the output is the expected one.
+ */
+static void testShortest(double value,const char * expected)
+{
+    char buf1[64];
+    char buf2[64];
+    int digits,n;
+    char * s;
+
+    xsnformat(buf1,sizeof(buf1),"%e",value);
+    for (digits = 0, s = buf1 ; *s && *s != 'e' ; s++)
+    {
+        if (*s >= '0' && *s <= '9')
+            digits++;
+    }
+
+    for (n = 1 ; n < digits ; n++)
+    {
+        sprintf(buf2,"%.*e",n - 1,value);
+        if (strtod(buf2,0) == value)
+            break;
+    }
+
+    xsnformat(buf2,sizeof(buf2),"%g",value);
+
+    if (strtod(buf1,0) != value || strtod(buf2,0) != value || n < digits || strcmp(buf2,expected))
+    {
+        fprintf(stderr,"XFormat : '%s' '%s'\nExpected: '%s' (%d digits) failed\n",buf1,buf2,expected,n);
+        exit(1);
+    }
+    else
+    {
+        printf("'%s' '%s'\n",buf1,buf2);
+    }
+}
+#endif
+
+#if XCFG_FORMAT_ARENA
+/**
+ * Number of chunks allocated and not released
+ */
+static int arenaChunks;
+
+static void * arenaAlloc(void *arg,void *ptr,size_t size)
+{
+    (void)arg;
+
+    if (size == 0)
+    {
+        arenaChunks--;
+        free(ptr);
+        return 0;
+    }
+
+    arenaChunks++;
+    return malloc(size);
+}
+#endif
+
 int main(void)
 {
     static int value;
@@ -115,11 +457,19 @@ int main(void)
     testFormat("Integer %+05d %-5d % 5d %05d",1234,1234,1234,1234);
     testFormat("Integer blank % d % d",1,-1);
     testFormat("Unsigned %u %lu",123,123Lu);
+    testFormat("Decimal %d %d %d %d %d %d %u",0,9,10,99,100,999999999,4294967295u);
+    testFormat("Decimal %d %d %.8d %-.3d| %8.5d %.1u",1000000000,-2147483647 - 1,1234,5,-42,0u);
     testFormat("Hex with prefix %#x %#x %#X %#08x",0,1,2,12345678);
+    testFormat("Large precision %.100x|%+.70d|%-+90.70d|%90.70d|% .80i|%.*u",0xabc,7,-9,-9,3,200,4u);
+    testFormat("Large precision %120.70o|%-110.66X|%#.90x|%.63d|%.64d|%.65d",0777,0xabc,0x12,-1,-1,-1);
     testFormat("Octal %o %lo",123,123456L);
     testFormat("Octal with prefix %#o %#o",0,5);
     testFormat("Hex %x %X %lX",0x1234,0xf0ad,0xf2345678L);
     testFormat("Special char %%");
+    testFormat("A long literal text without conversion to check the scan of the runs");
+    testFormat("%d leading, trailing %d and %%%% in the middle of a long literal text %s",1,2,"end");
+    testFormat("0123456789abcdef0123456789abcdef%d0123456789abcdef0%d1234567",1,2);
+    testFormat("\t\x7f\xe8 non printable chars %d \x80\xff",3);
     testFormat("Size    of void * %u(%u)",(size_t)sizeof(void *),(size_t)sizeof(void *));
 	testFormat("Sizeof char=%d short=%d int=%d long=%d void*=%u size_t=%u",
 			   sizeof(char),sizeof(short),sizeof(int),sizeof(long),sizeof(void *),sizeof(size_t));
@@ -143,10 +493,62 @@ int main(void)
 	testFormat("Floating > 32 bit %f",pow(2.0,32.0)+1.0);
 	testFormat("Floating < 32 bit %f",-pow(2.0,32.0)-1.0);
 #endif
+#if XCFG_FORMAT_FLOAT_EXACT && XCFG_FORMAT_FLOAT_PREC == 0
+	testFormat("Exact %f %f %f",1e300,-1e22,DBL_MAX);
+	testFormat("Exact %.20f %.30f",1e-300,DBL_MIN);
+	testFormat("Exact %.400f",-4.9406564584124654e-324);
+	testFormat("Exact %.700f",DBL_MIN / 4.0);
+	testFormat("Exact %.0f %.0f %.0f %.0f %.0f",0.5,1.5,2.5,-3.5,1e15 + 0.5);
+	testFormat("Exact %.2f %.2f %.2f %.1f",0.125,0.375,1.005,0.25);
+	testFormat("Exact %.20f %.17f %.9f %.10f",0.1,2.0/3.0,999999999.9999999,9.99999999995);
+	testFormat("Exact %.3f %.3f %.5f",0.9995,9.9995,0.000005);
+	testFormat("Exact %#.0f %#f %.0f %#.0f %.f",3.0,0.0,0.0,-0.0,2.5);
+	testFormat("Exact %f %+.1f % .3f",-0.0,0.0,0.0);
+	testFormat("Exact %f %+f %f",HUGE_VAL,HUGE_VAL,-HUGE_VAL);
+	testFormat("Exact %f %8f|%-8f|%08.2f",nan(""),HUGE_VAL,-HUGE_VAL,-1.5);
+	testFormat("Exact |%20.3f|%-20.3f|%+020.3f|% 20f|",3.14159,-3.14159,2.71828,1e10);
+	testFormat("Exact %*.*f %.15f",12,4,123.456789,0.1 + 0.2);
+	testFormat("Exact %f %f %f",1.0 / 3.0,123456789012345678.0,4294967296.5);
+	testFormat("Exp %.6e %.0e %#.0e %.3E %.20e",1.0,2.5,3.0,-0.00012345,0.1);
+	testFormat("Exp %.2e %.2e %.3e %.e",9.995,9.996,999.95,0.0);
+	testFormat("Exp %.6e %.6e %.10e",DBL_MAX,DBL_MIN,4.9406564584124654e-324);
+	testFormat("Exp %.80e",1e-300);
+	testFormat("Exp |%15.3e|%-15.3e|%+015.3e|% .6e|",31415.9,-31415.9,2.5e-10,1e100);
+	testFormat("Exp %e %E %e",HUGE_VAL,-HUGE_VAL,nan(""));
+	testFormat("General %.6g %.6g %.6g %.6g %.6g",0.0001,0.00001,123456.0,1234567.0,100.0);
+	testFormat("General %.0g %.1g %.2g %.3G %.10g",2.5,0.15,99.5,1e-10,1.0 / 3.0);
+	testFormat("General %#.6g %#.3g %#.0g %#g",1.0,0.0001,5.0,-0.0);
+	testFormat("General %.17g %.17g %.17g %.25g",0.1,DBL_MAX,DBL_MIN,5e-324);
+	testFormat("General |%12.4g|%-12.4G|%+012.4g|% g|",1234.5,1e-20,-0.5,1e300);
+	testFormat("General %g %G",HUGE_VAL,-HUGE_VAL);
+#if XCFG_FORMAT_FLOAT_SHORTEST == 0
+	testFormat("General %e %g %g %g %g",6.02e23,1e-12,0.1,22.0 / 7.0,1e6);
+#endif
+#endif
+#if XCFG_FORMAT_FLOAT_SHORTEST && XCFG_FORMAT_FLOAT_PREC == 0
+	testShortest(0.1,"0.1");
+	testShortest(0.3,"0.3");
+	testShortest(1e-12,"1e-12");
+	testShortest(6.02e23,"6.02e+23");
+	testShortest(22.0 / 7.0,"3.142857142857143");
+	testShortest(1234567.0,"1234567");
+	testShortest(1e6,"1e+06");
+	testShortest(-2.5,"-2.5");
+	testShortest(5e-324,"5e-324");
+	testShortest(DBL_MAX,"1.7976931348623157e+308");
+	testShortest(DBL_MIN,"2.2250738585072014e-308");
+	testShortest(9007199254740993.0,"9007199254740992");
+	testShortest(6.3108872417680944e-30,"6.310887241768095e-30");
+	testFormat("Shortest %.3g %.2e",0.1,0.1);
+#endif
 #endif
 
     testFormat("*Sizeof of void * %zu",sizeof(void *));
     testFormat("*Binary number %b %#b",5,6);
+    testFormat("*Binary number %b %8b %.12b %#b",0,5,5u,0xFFFFFFFFu);
+    testFormat("Radix %x %o %#o %.6x %#010x %X",0,0,8,0xabc,0xdef,0xFFFFFFFFu);
+    testFormat("Radix chunks %.20x %.40x %.24X",0x12345678u,0xabcdefu,0xFEDCBA98u);
+    testFormat("*Null ptr %p",(void *)0);
     testFormat("*Stack  ptr %p %P",stackPtr,stackPtr);
     testFormat("*Static ptr %p %P",ptr,ptr);
     testFormat("*Text   ptr %p %P",xvformat,xvformat);
@@ -161,9 +563,530 @@ int main(void)
 #if XCFG_FORMAT_LONGLONG
     testFormat("long long int %lld",(long long)123);
     testFormat("long long int %lld",(long long)-123);
+    testFormat("long long int %lld %lld %llu",1234567890123456789LL,-9223372036854775807LL - 1,18446744073709551615ULL);
+    testFormat("long long int %lld %llu %.25lld %030lld",99999999LL,100000000ULL,4294967296LL,-4294967295LL);
 	testFormat("long long hex %#llx",(long long)0x123456789abcdef);
     testFormat("long long hex %#llX",(long long)0x123456789abcdef);
+    testFormat("long long radix %llx %llo %#llX %.20llx",~0ULL,~0ULL,1ULL << 63,1ULL);
+    testFormat("*long long binary %llb %#llb",~0ULL,1ULL << 40);
+    testFormat("*long long binary %.70llb|%-+.80lld|%.100llx",~0ULL,-1LL,~0ULL);
+#endif
+    {
+        struct xformat_spec_s prog[3];
+
+        if (xformat_compile("%d %d",prog,3) != 0 || xformat_compile("%d",prog,3) != 3)
+        {
+            fprintf(stderr,"Compile storage check failed\n");
+            exit(1);
+        }
+    }
+
+    testFormat("String %.3s|%.0s|%.10s|%-8.2s|%8.5s|%.*s","abcdef","xyz","short","left","right",3,"star");
+    testFormat("*Not conversion %y %5y %% %5%|%-");
+    {
+        static const char view[4] = {'v','i','e','w'};
+        char buf1[64];
+        char * big;
+
+        /* Precision and views read only the chars they print */
+        big = (char *)malloc(100000);
+        memset(big,'x',100000);
+        if (xsnformat(buf1,sizeof(buf1),"%.4s|%v|%V|%.2v|%6v|%-6.3v|%v",view,view,(size_t)4,view,(size_t)4,view,(size_t)4,
+                     view,(size_t)4,view,(size_t)4,(char *)0,(size_t)0) != 38 ||
+            strcmp(buf1,"view|view|VIEW|vi|  view|vie   |(null)") ||
+            xsnformat(buf1,sizeof(buf1),"%.10s|%.0s|%v",big,big,big + 99990,(size_t)10) != 22 ||
+            strcmp(buf1,"xxxxxxxxxx||xxxxxxxxxx"))
+        {
+            fprintf(stderr,"View '%s' failed\n",buf1);
+            exit(1);
+        }
+        free(big);
+        printf("%s\n",buf1);
+    }
+    testTruncate(0,"Truncate %d",12345);
+    testTruncate(1,"Truncate %d",12345);
+    testTruncate(8,"Truncate %d",12345);
+    testTruncate(12,"Truncate %8d|",12345);
+    testTruncate(14,"Truncate %-8s|","abc");
+    testTruncate(16,"Truncate %s","a long string");
+#if XCFG_FORMAT_LONGLONG
+    testRadix();
+#endif
+
+    {
+        char buf[64];
+        char * s = buf;
+
+        /* Context with a write function and with truncation in memory */
+        if (xformat_ctx(&testCtx,myWrite,(void *)&s,"Ctx %d %s|%5x",-7,"str",255) != 16 ||
+            (*s = 0,strcmp(buf,"Ctx -7 str|   ff")) ||
+            xsnformat_ctx(&testCtx,buf,8,"Ctx %d %s",-7,"string") != 13 || strcmp(buf,"Ctx -7 "))
+        {
+            fprintf(stderr,"Context '%s' failed\n",buf);
+            exit(1);
+        }
+    }
+
+#if XCFG_FORMAT_DEFER
+    {
+        char text[8] = "before";
+        char buf[256];
+        char * s;
+        int i,n;
+
+        xformat_ring_init(&deferRing,deferStorage,sizeof(deferStorage));
+
+        testDefer("Defer %d %u %x %5.3d %-4d|",-12,34u,0xabc,7,5);
+        testDefer("Defer %ld %lu %lX %zu %p",-123456L,123456UL,0xfedcL,sizeof(int),(void *)buf);
+        testDefer("Defer %s|%S|%10s|%-6s|%s","string","upper","right","left",(char *)0);
+        testDefer("Defer %c%C %B %B %%",'a','b',1,0);
+        testDefer("Defer %.3s|%.*s|%v|%-6.2V|%v",buf,2,"abc","viewed",(size_t)4,"upper",(size_t)5,(char *)0,(size_t)9);
+        testDefer("Defer %*d %-*.*d",6,42,8,4,7);
+
+        /* The string is read only up to the run time precision */
+        {
+            static const char unterminated[4] = {'a','b','c','d'};
+
+            testDefer("Defer %.*s|%.*s|%-5.*s|",4,unterminated,-1,"full",2,unterminated);
+        }
+
+        /* A view longer than the ring is copied only up to the precision */
+        {
+            static char big[sizeof(deferStorage) * 2];
+
+            memset(big,'v',sizeof(big));
+            testDefer("Defer %.*v|%-4.*V|%.2v|",3,big,sizeof(big),2,"view",(size_t)4,big,sizeof(big));
+        }
+#if XCFG_FORMAT_LONGLONG
+        testDefer("Defer %lld %llu %#llx",-1234567890123LL,1234567890123ULL,0x123456789abcdefULL);
+#endif
+#if XCFG_FORMAT_FLOAT
+        testDefer("Defer %f %6.2f %.0f",-0.6,22.0 / 7.0,2.5);
+#endif
+
+        /* Strings are captured when the record is written */
+        xformat_defer(&deferRing,"String %s",text);
+        strcpy(text,"after");
+        s = buf;
+        xformat_replay(&deferRing,myWrite,(void *)&s);
+        *s = 0;
+        if (strcmp(buf,"String before"))
+        {
+            fprintf(stderr,"Defer string '%s' failed\n",buf);
+            exit(1);
+        }
+
+#if XCFG_FORMAT_DEFER_FMT
+        /* The format is copied in the record too */
+        strcpy(text,"F %d");
+        xformat_defer(&deferRing,text,42);
+        strcpy(text,"G %s");
+        s = buf;
+        xformat_replay(&deferRing,myWrite,(void *)&s);
+        *s = 0;
+        if (strcmp(buf,"F 42"))
+        {
+            fprintf(stderr,"Defer format '%s' failed\n",buf);
+            exit(1);
+        }
+#endif
+
+        /* Fill the ring, the records that do not fit are lost */
+        for (i = n = 0 ; i < 20 ; i++)
+        {
+            if (xformat_defer(&deferRing,"Record %d %s;",i,"abcdefgh"))
+                n++;
+        }
+
+        s = buf;
+        if (xformat_replay(&deferRing,myWrite,(void *)&s) != (unsigned)n || deferRing.lost != (unsigned long)(20 - n) || n == 0)
+        {
+            fprintf(stderr,"Defer full ring %d records %lu lost failed\n",n,deferRing.lost);
+            exit(1);
+        }
+        *s = 0;
+        printf("'%s' lost %lu\n",buf,deferRing.lost);
+
+        /* Records wrapped at the end of the storage */
+        for (i = 0 ; i < 50 ; i++)
+        {
+            testDefer("Wrap %d %s %ld",i,i & 1 ? "odd" : "even",(long)i * 1000);
+        }
+    }
+#endif
+
+#if XCFG_FORMAT_CACHE
+    {
+        static char reused[32];
+        char buf1[64];
+        unsigned long hits,misses,hits0,misses0;
+        int i;
+#if XCFG_FORMAT_STATS
+        struct xformat_stats_s stats;
+
+        xformat_stats_reset();
+#endif
+
+        /* The same format executed again must be found in the cache */
+        xformat_cache_stats(&hits0,&misses0);
+        for (i = 0 ; i < 4 ; i++)
+        {
+            xsnformat(buf1,sizeof(buf1),"Cached %d %s",i,"format");
+        }
+
+        xformat_cache_stats(&hits,&misses);
+#if XCFG_FORMAT_CACHE_SPECS >= 4
+        if (hits - hits0 != 3 || misses - misses0 != 1)
+#else
+        if (hits - hits0 != 0 || misses - misses0 != 4)
+#endif
+        {
+            fprintf(stderr,"Format cache hits %lu misses %lu failed\n",hits - hits0,misses - misses0);
+            exit(1);
+        }
+
+#if XCFG_FORMAT_STATS
+        xformat_stats(&stats);
+        if (stats.cachehits != hits - hits0 || stats.cachemisses != misses - misses0)
+        {
+            fprintf(stderr,"Format stats cache hits %lu misses %lu failed\n",stats.cachehits,stats.cachemisses);
+            exit(1);
+        }
 #endif
+
+        /* A buffer reused for a different format must be compiled again */
+        strcpy(reused,"Cached %d %s");
+        testFormat(reused,1,"format");
+        testFormat(reused,2,"again");
+        strcpy(reused,"Other %s %x");
+        testFormat(reused,"format",255u);
+        strcpy(reused,"Literal");
+        testFormat(reused);
+
+        /* Same first chars and same length, changed only at the end */
+        strcpy(reused,"Request %d from %s");
+        testFormat(reused,1,"host");
+        strcpy(reused,"Request %d from %x");
+        testFormat(reused,2,255u);
+
+        /* Formats with too many specifiers are always parsed */
+        testFormat("%d %d %d %d %d %d %d %d %d %d",1,2,3,4,5,6,7,8,9,10);
+        testFormat("%d %d %d %d %d %d %d %d %d %d",10,9,8,7,6,5,4,3,2,1);
+    }
+#endif
+
+#if XCFG_FORMAT_BATCH
+    {
+        static const int ids[] = {1,-22,333,0};
+        static const long counts[] = {100000L,-7L,0L,2147483647L};
+        static const int widths[] = {6,3,1,8};
+        static const char * const names[] = {"alpha","beta","gamma",0};
+#if XCFG_FORMAT_FLOAT
+        static const double values[] = {0.5,-12.25,1e6,3.0625};
+#endif
+        const void * columns[20];
+        char buf1[512];
+        char buf2[512];
+        char * s;
+        unsigned count,n;
+        int i;
+
+        columns[0] = ids;
+        columns[1] = counts;
+        columns[2] = widths;
+        columns[3] = names;
+#if XCFG_FORMAT_FLOAT
+        columns[4] = values;
+#endif
+
+        s = buf1;
+#if XCFG_FORMAT_FLOAT
+        count = xformat_batch("%d,%ld,%*s,%.2f\n",columns,4,myWrite,(void *)&s);
+#else
+        count = xformat_batch("%d,%ld,%*s\n",columns,4,myWrite,(void *)&s);
+#endif
+        *s = 0;
+
+        for (i = n = 0 ; i < 4 ; i++)
+        {
+#if XCFG_FORMAT_FLOAT
+            n += xsnformat(buf2 + n,sizeof(buf2) - n,"%d,%ld,%*s,%.2f\n",ids[i],counts[i],widths[i],names[i],values[i]);
+#else
+            n += xsnformat(buf2 + n,sizeof(buf2) - n,"%d,%ld,%*s\n",ids[i],counts[i],widths[i],names[i]);
+#endif
+        }
+
+        if (count != n || strcmp(buf1,buf2))
+        {
+            fprintf(stderr,"Batch   : '%s' (%u)\nXFormat : '%s' (%u) failed\n",buf1,count,buf2,n);
+            exit(1);
+        }
+
+        printf("%s",buf1);
+
+        /* More specifiers than the compiled program, parsed for each row */
+        for (i = 0 ; i < 20 ; i++)
+        {
+            columns[i] = ids;
+        }
+
+        s = buf1;
+        count = xformat_batch("%d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d;",columns,4,myWrite,(void *)&s);
+        *s = 0;
+
+        for (i = n = 0 ; i < 4 ; i++)
+        {
+            n += xsnformat(buf2 + n,sizeof(buf2) - n,"%d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d;",
+                    ids[i],ids[i],ids[i],ids[i],ids[i],ids[i],ids[i],ids[i],ids[i],ids[i],
+                    ids[i],ids[i],ids[i],ids[i],ids[i],ids[i],ids[i],ids[i],ids[i],ids[i]);
+        }
+
+        if (count != n || strcmp(buf1,buf2))
+        {
+            fprintf(stderr,"Batch   : '%s' (%u)\nXFormat : '%s' (%u) failed\n",buf1,count,buf2,n);
+            exit(1);
+        }
+
+        printf("%s\n",buf1);
+    }
+#endif
+
+#if XCFG_FORMAT_STATS
+    {
+        struct xformat_stats_s stats;
+        char buf1[64];
+        char * s;
+
+        xformat_stats_reset();
+
+        /* 12 chars, 3 of padding, truncated to 7 */
+        xsnformat(buf1,8,"%d %5s|%x%x",1,"ab",255u,16u);
+        s = buf1;
+        xformat_write(myWrite,(void *)&s,"%s %s",__FILE__,"x");
+
+        xformat_stats(&stats);
+
+        if (stats.calls != 2 || stats.bytes != 12 + strlen(__FILE__) + 2 || stats.padding != 3 ||
+            stats.truncations != 1 || stats.writes < 3 ||
+            stats.conv[XFORMAT_STATS_INDEX('d')] != 1 || stats.conv[XFORMAT_STATS_INDEX('x')] != 2 ||
+            stats.conv[XFORMAT_STATS_INDEX('s')] != 3 || stats.conv[XFORMAT_STATS_INDEX('f')] != 0)
+        {
+            fprintf(stderr,"Stats calls %lu bytes %lu padding %lu truncations %lu writes %lu failed\n",
+                    stats.calls,stats.bytes,stats.padding,stats.truncations,stats.writes);
+            exit(1);
+        }
+
+        printf("Stats calls %lu bytes %lu padding %lu truncations %lu writes %lu\n",
+                stats.calls,stats.bytes,stats.padding,stats.truncations,stats.writes);
+    }
+#endif
+
+#if XCFG_FORMAT_IOV
+    {
+        static const char payload[] = "0123456789abcdefghijklmnopqrstuvwxyz0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+        static const char fmt[] = "Request %d from %s status %5u, body %s|%-40s|\n";
+        struct xformat_iovec_s iov[64];
+        struct xformat_iov_s v;
+        char arena[256];
+        char buf1[512];
+        char buf2[512];
+        unsigned count,n,i;
+        int ref = 0;
+        int pad = 0;
+
+        xformat_iov_init(&v,iov,64,arena,sizeof(arena));
+        count = xformat_iov(&v,fmt,-42,"host",200u,payload,"left");
+        count += xformat_iov(&v,"%x %S\n",0xcafeu,"upper");
+
+        for (i = n = 0 ; i < v.count ; i++)
+        {
+            memcpy(buf1 + n,iov[i].iov_base,iov[i].iov_len);
+            n += (unsigned)iov[i].iov_len;
+            if (iov[i].iov_base == (void *)payload)
+                ref = 1;
+            if (*(char *)iov[i].iov_base == ' ' && iov[i].iov_len >= XCFG_FORMAT_IOV_MIN &&
+                ((char *)iov[i].iov_base < arena || (char *)iov[i].iov_base >= arena + sizeof(arena)))
+                pad = 1;
+        }
+        buf1[n] = 0;
+
+        xsnformat(buf2,sizeof(buf2),fmt,-42,"host",200u,payload,"left");
+        xsnformat(buf2 + strlen(buf2),sizeof(buf2) - strlen(buf2),"%x %S\n",0xcafeu,"upper");
+
+        /* The payload and the padding are referenced and not copied */
+        if (sizeof(payload) - 1 < XCFG_FORMAT_IOV_MIN)
+            ref = 1;
+        if (36 < XCFG_FORMAT_IOV_MIN)
+            pad = 1;
+        if (count != n || strcmp(buf1,buf2) || !ref || !pad || v.truncated || v.used > n)
+        {
+            fprintf(stderr,"Iov     : '%s' (%u) ref %d pad %d used %u\nXFormat : '%s' failed\n",buf1,count,ref,pad,(unsigned)v.used,buf2);
+            exit(1);
+        }
+
+        printf("%s",buf1);
+
+        /* Padding longer than the static block */
+        xformat_iov_init(&v,iov,64,arena,sizeof(arena));
+        count = xformat_iov(&v,"%0150d|%-100s|",-7,"x");
+        for (i = n = 0 ; i < v.count ; i++)
+        {
+            memcpy(buf1 + n,iov[i].iov_base,iov[i].iov_len);
+            n += (unsigned)iov[i].iov_len;
+        }
+        buf1[n] = 0;
+        xsnformat(buf2,sizeof(buf2),"%0150d|%-100s|",-7,"x");
+        if (count != n || strcmp(buf1,buf2) || v.truncated || (XCFG_FORMAT_IOV_MIN <= 99 && v.used > 5))
+        {
+            fprintf(stderr,"Iov     : '%s' (%u) used %u\nXFormat : '%s' failed\n",buf1,count,(unsigned)v.used,buf2);
+            exit(1);
+        }
+
+        /* Arena too small, the output is truncated */
+        xformat_iov_init(&v,iov,64,arena,4);
+        if (xformat_iov(&v,"%d",123456) != 6 || !v.truncated || v.count != 1 || iov[0].iov_len != 4)
+        {
+            fprintf(stderr,"Iov truncation failed\n");
+            exit(1);
+        }
+    }
+#endif
+
+#if XCFG_FORMAT_ARGS
+    {
+        struct xformat_arg_s args[6];
+        struct xformat_spec_s prog[8];
+        char buf1[128];
+        char buf2[128];
+        char * s;
+        unsigned count;
+
+        args[0].type = XFORMAT_ARG_INT;
+        args[0].value.i = -12;
+        args[1].type = XFORMAT_ARG_UINT;
+        args[1].value.u = 255;
+        args[2].type = XFORMAT_ARG_STRING;
+        args[2].value.s = "str";
+        args[3].type = XFORMAT_ARG_INT;
+        args[3].value.i = 6;
+#if XCFG_FORMAT_LONGLONG
+        /* The size is given by the tag and not by the specifier */
+        args[4].type = XFORMAT_ARG_LLONG;
+        args[4].value.i = -1099511627776LL;
+#else
+        args[4].type = XFORMAT_ARG_LONG;
+        args[4].value.i = -65536L;
+#endif
+        args[5].type = XFORMAT_ARG_POINTER;
+        args[5].value.p = 0;
+
+        /* The last specifier has no argument and read 0 */
+        s = buf1;
+        count = xformat_args(myWrite,(void *)&s,"Args %d %x %s|%*d|%p|%u",args,6);
+        *s = 0;
+
+#if XCFG_FORMAT_LONGLONG
+        xsnformat(buf2,sizeof(buf2),"Args %d %x %s|%*lld|%p|%u",-12,255u,"str",6,-1099511627776LL,(void *)0,0u);
+#else
+        xsnformat(buf2,sizeof(buf2),"Args %d %x %s|%*ld|%p|%u",-12,255u,"str",6,-65536L,(void *)0,0u);
+#endif
+        if (count != strlen(buf2) || strcmp(buf1,buf2))
+        {
+            fprintf(stderr,"Args    : '%s' (%u)\nXFormat : '%s' failed\n",buf1,count,buf2);
+            exit(1);
+        }
+
+        printf("%s\n",buf1);
+
+        /* Same arguments for a compiled format */
+        s = buf1;
+        xformat_compile("Args %d %x %s|%*d|%p|%u",prog,sizeof(prog) / sizeof(prog[0]));
+        count = xformat_compiled_args(prog,myWrite,(void *)&s,args,6);
+        *s = 0;
+
+        if (count != strlen(buf2) || strcmp(buf1,buf2))
+        {
+            fprintf(stderr,"Compiled: '%s' (%u)\nXFormat : '%s' failed\n",buf1,count,buf2);
+            exit(1);
+        }
+
+        printf("%s\n",buf1);
+    }
+#endif
+
+#if XCFG_FORMAT_ARENA
+    {
+        struct xformat_arena_s arena;
+        struct xformat_str_s str[64];
+        char first[32];
+        char big[XCFG_FORMAT_ARENA_CHUNK + 100];
+        char buf1[sizeof(big) + 32];
+        int i,pass,chunks = 0;
+
+        memset(big,'b',sizeof(big) - 1);
+        big[sizeof(big) - 1] = 0;
+        xformat_arena_init(&arena,first,sizeof(first),arenaAlloc,0);
+
+        /* The second pass must use again the chunks of the first */
+        for (pass = 0 ; pass < 2 ; pass++)
+        {
+            for (i = 0 ; i < 64 ; i++)
+            {
+                if (i == 40)
+                    str[i] = xaformat(&arena,"%s|%d",big,i);
+                else if (i == 50)
+                    str[i] = xaformat(&arena,"");
+                else
+                    str[i] = xaformat(&arena,"String %d %s %*x",i,"arena",i,(unsigned)i * 0x1234567u);
+            }
+
+            for (i = 0 ; i < 64 ; i++)
+            {
+                if (i == 40)
+                    xsnformat(buf1,sizeof(buf1),"%s|%d",big,i);
+                else if (i == 50)
+                    buf1[0] = 0;
+                else
+                    xsnformat(buf1,sizeof(buf1),"String %d %s %*x",i,"arena",i,(unsigned)i * 0x1234567u);
+
+                if (str[i].str == 0 || str[i].len != strlen(buf1) || strcmp(str[i].str,buf1))
+                {
+                    fprintf(stderr,"Arena pass %d string %d '%s' failed\n",pass,i,str[i].str ? str[i].str : "(null)");
+                    exit(1);
+                }
+            }
+
+            if (pass == 0)
+                chunks = arenaChunks;
+            else if (arenaChunks != chunks)
+            {
+                fprintf(stderr,"Arena %d chunks after reset, %d before\n",arenaChunks,chunks);
+                exit(1);
+            }
+
+            xformat_arena_reset(&arena);
+        }
+
+        xformat_arena_free(&arena);
+
+        /* Without allocator the strings that do not fit fail */
+        xformat_arena_init(&arena,first,sizeof(first),0,0);
+        str[0] = xaformat(&arena,"%d",12345);
+        str[1] = xaformat(&arena,"%s",big);
+        str[2] = xaformat(&arena,"%s","0123456789abcdef0123456789abcdef");
+        str[3] = xaformat(&arena,"%x",0xabcdu);
+
+        if (arenaChunks != 0 || chunks < 2 || str[1].str != 0 || str[2].str != 0 ||
+            str[0].str != first || strcmp(str[0].str,"12345") || str[3].str != first + 6 || strcmp(str[3].str,"abcd"))
+        {
+            fprintf(stderr,"Arena %d chunks, %d allocated failed\n",arenaChunks,chunks);
+            exit(1);
+        }
+
+        printf("Arena %d chunks of %d bytes\n",chunks,XCFG_FORMAT_ARENA_CHUNK);
+    }
+#endif
+
     fprintf(stderr,"\nTest completed successfully\n");
 
     return 0;